@@ -20,6 +20,7 @@
 #include "platform_basic.h"
 #include "platform_virt.h"
 #include "platform_device_tree.h"
+#include "smp.h"
 
 #include "virtio_block.h"
 #include "virtio_net.h"
@@ -29,7 +30,7 @@ static volatile bool m_user_abort = false;
 //-----------------------------------------------------------------
 // Command line options
 //-----------------------------------------------------------------
-#define GETOPTS_ARGS "m:t:v:f:c:r:b:s:e:ED:P:p:j:k:V:T:h"
+#define GETOPTS_ARGS "m:t:v:f:c:r:b:s:e:ED:P:p:j:k:V:T:d:L:x:X:u:w:n:q:Hh"
 
 static struct option long_options[] =
 {
@@ -52,6 +53,15 @@ static struct option long_options[] =
     {"elf-phys",   no_argument,       0, 'E'},
     {"vda",        required_argument, 0, 'V'},
     {"tap",        required_argument, 0, 'T'},
+    {"huge-pages", no_argument,       0, 'H'},
+    {"decode-cache", required_argument, 0, 'd'},
+    {"poll-skip",  required_argument, 0, 'L'},
+    {"block-exec", required_argument, 0, 'x'},
+    {"dbt",        required_argument, 0, 'X'},
+    {"tlb-sets",   required_argument, 0, 'u'},
+    {"tlb-ways",   required_argument, 0, 'w'},
+    {"harts",      required_argument, 0, 'n'},
+    {"quantum",    required_argument, 0, 'q'},
     {"help",       no_argument,       0, 'h'},
     {0, 0, 0, 0}
 };
@@ -71,6 +81,15 @@ static void help_options(void)
     fprintf (stderr,"  --elf-phys   | -E            Load to ELF section to physical addresses (suitable for bootloaders)\n");
     fprintf (stderr,"  --mem-base   | -b VAL        Memory base address (for binary loads)\n");
     fprintf (stderr,"  --mem-size   | -s VAL        Memory size (for binary loads)\n");
+    fprintf (stderr,"  --huge-pages | -H            Back memory with transparent huge pages (default: off)\n");
+    fprintf (stderr,"  --decode-cache | -d 1/0      Pre-decoded instruction cache (default: 1)\n");
+    fprintf (stderr,"  --poll-skip  | -L 1/0        Skip time in MMIO busy-poll loops (default: 0)\n");
+    fprintf (stderr,"  --block-exec | -x 1/0        Superblock execution with block chaining (default: 0)\n");
+    fprintf (stderr,"  --dbt        | -X 1/0        Translate hot RV64 code to x86-64 (default: 0)\n");
+    fprintf (stderr,"  --tlb-sets   | -u num        TLB sets (per I/D TLB, default: 64)\n");
+    fprintf (stderr,"  --tlb-ways   | -w num        TLB ways (default: 4)\n");
+    fprintf (stderr,"  --harts      | -n num        Number of harts, one host thread each (default: 1)\n");
+    fprintf (stderr,"  --quantum    | -q num        Run harts round robin on one thread, num steps per turn (deterministic, default: 0 = off)\n");
     fprintf (stderr,"  --dump-file  | -p FILE       File to dump memory contents to after completion\n");
     fprintf (stderr,"  --dump-start | -j SYM/A      Symbol name for memory dump start (or 0xADDR)\n");
     fprintf (stderr,"  --dump-end   | -k SYM/A      Symbol name for memory dump end (or 0xADDR)\n");
@@ -109,8 +128,7 @@ static bool create_dump_file(cpu *sim, const char *dump_file, uint32_t dump_star
     printf("Dumping post simulation memory: 0x%08x-0x%08x (%d bytes) [%s]\n", dump_start, dump_end, dump_size, dump_file);
 
     uint8_t *buffer = new uint8_t[dump_size];
-    for (uint32_t i=0;i<dump_size;i++)
-        buffer[i] = sim->read(dump_start + i);
+    sim->read_block(dump_start, buffer, dump_size);
 
     // Binary block
     if (!sig_txt_file)
@@ -231,7 +249,6 @@ static bool create_dump_regfile(cpu *sim, const char *dump_file, uint32_t dump_n
 //-----------------------------------------------------------------
 int main(int argc, char *argv[])
 {
-    uint64_t       cycles         = 0;
     int64_t        max_cycles     = (int64_t)-1;
     const char *   filename       = NULL;
     const char *   march          = NULL;
@@ -256,6 +273,15 @@ int main(int argc, char *argv[])
     bool           load_phys      = false;
     const char *   vda_file       = NULL;
     const char *   tap_device     = NULL;
+    bool           huge_pages     = false;
+    int            decode_cache   = 1;
+    int            poll_skip      = 0;
+    int            block_exec     = 0;
+    int            dbt            = 0;
+    int            tlb_sets       = TLB_SETS_DEFAULT;
+    int            tlb_ways       = TLB_WAYS_DEFAULT;
+    int            harts          = 1;
+    uint64_t       quantum        = 0;
     int c;
 
     int option_index = 0;
@@ -331,6 +357,33 @@ int main(int argc, char *argv[])
             case 'T':
                 tap_device = optarg;
                 break;
+            case 'H':
+                huge_pages = true;
+                break;
+            case 'd':
+                decode_cache = strtoul(optarg, NULL, 0);
+                break;
+            case 'L':
+                poll_skip = strtoul(optarg, NULL, 0);
+                break;
+            case 'x':
+                block_exec = strtoul(optarg, NULL, 0);
+                break;
+            case 'X':
+                dbt = strtoul(optarg, NULL, 0);
+                break;
+            case 'u':
+                tlb_sets = strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                tlb_ways = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                harts = strtoul(optarg, NULL, 0);
+                break;
+            case 'q':
+                quantum = strtoull(optarg, NULL, 0);
+                break;
             case '?':
             default:
                 help = 1;   
@@ -338,7 +391,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (help || (filename == NULL))
+    if (help || (filename == NULL) || harts < 1)
         help_options();
 
     console_io *con = new console();
@@ -371,6 +424,12 @@ int main(int argc, char *argv[])
     if (!sim)
         return -1;
     sim->set_console(con);
+    sim->enable_huge_pages(huge_pages);
+    sim->enable_decode_cache(decode_cache != 0);
+    sim->enable_poll_skip(poll_skip != 0);
+    sim->enable_block_exec(block_exec != 0);
+    sim->enable_dbt(dbt != 0);
+    sim->configure_tlb(tlb_sets, tlb_ways);
 
     if (explicit_mem)
     {
@@ -431,7 +490,7 @@ int main(int argc, char *argv[])
     else
     {
         elf_load elf(filename, sim, load_phys);
-        if (!elf.load())
+        if (!elf.load_segments(true))
         {
             fprintf (stderr,"Error: Could not open %s\n", filename);
             return -1;
@@ -459,38 +518,60 @@ int main(int argc, char *argv[])
     if (trace)
         sim->enable_trace(trace_mask);
 
-    cycles = 0;
+    // Additional harts (sharing memory and devices with hart 0)
+    smp cores;
+    cores.set_quantum(quantum);
+    cores.add_hart(sim);
+    for (int i=1;i<harts;i++)
+    {
+        cpu *hart = plat->create_hart(i);
+        if (!hart)
+        {
+            fprintf (stderr,"Error: Platform does not support multiple harts\n");
+            return -1;
+        }
+
+        hart->set_console(con);
+        hart->enable_decode_cache(decode_cache != 0);
+        hart->enable_poll_skip(poll_skip != 0);
+        hart->enable_block_exec(block_exec != 0);
+        hart->enable_dbt(dbt != 0);
+        hart->configure_tlb(tlb_sets, tlb_ways);
+        hart->reset(start_addr);
+        if (trace)
+            hart->enable_trace(trace_mask);
+
+        cores.add_hart(hart);
+    }
 
     // Catch SIGINT to restore terminal settings on exit
     signal(SIGINT, sigint_handler);
 
-    uint32_t current_pc = 0;
-    while (!sim->get_fault() && !sim->get_stopped() && current_pc != stop_pc && !m_user_abort)
-    {
-        current_pc = sim->get_pc();
-        sim->step();
-        cycles++;
-
-        if (max_cycles != (int64_t)-1 && max_cycles == cycles)
-            break;
+    run_limits limits;
+    limits.stop_pc       = stop_pc;
+    limits.trace_pc      = trace_pc;
+    limits.trace_mask    = trace_mask;
+    limits.stop_on_break = false;
+    limits.abort         = &m_user_abort;
 
-        // Turn trace on
-        if (trace_pc == current_pc)
-            sim->enable_trace(trace_mask);
-    }
+    cores.run((max_cycles != (int64_t)-1) ? (uint64_t)max_cycles : RUN_FOREVER, limits);
 
     // Fault occurred?
-    if (sim->get_fault())
-        return 1;
-    else
+    for (int i=0;i<harts;i++)
+        if (cores.get_hart(i)->get_fault())
+            return 1;
+
+    // Dump memory contents after execution?
+    if (dump_file)
+        create_dump_file(sim, dump_file, dump_start, dump_end);
+    if (dump_reg_file)
+        create_dump_regfile(sim, dump_reg_file, dump_reg_num);
+
+    for (int i=0;i<harts;i++)
     {
-        // Dump memory contents after execution?
-        if (dump_file)
-            create_dump_file(sim, dump_file, dump_start, dump_end);
-        if (dump_reg_file)
-            create_dump_regfile(sim, dump_reg_file, dump_reg_num);
-
-        sim->stats_dump();
-        return 0;
+        if (harts > 1)
+            printf("Hart %d:\n", i);
+        cores.get_hart(i)->stats_dump();
     }
+    return 0;
 }
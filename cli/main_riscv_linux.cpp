@@ -19,6 +19,7 @@
 
 #include "platform_device_tree.h"
 #include "sbi.h"
+#include "smp.h"
 
 #include "virtio_block.h"
 #include "virtio_net.h"
@@ -28,7 +29,7 @@ static volatile bool m_user_abort = false;
 //-----------------------------------------------------------------
 // Command line options
 //-----------------------------------------------------------------
-#define GETOPTS_ARGS "t:v:r:f:D:B:m:c:e:V:T:i:b:h"
+#define GETOPTS_ARGS "t:v:r:f:D:B:m:c:e:V:T:i:b:d:L:x:X:u:w:n:q:Hh"
 
 static struct option long_options[] =
 {
@@ -45,6 +46,15 @@ static struct option long_options[] =
     {"vda",        required_argument, 0, 'V'},
     {"tap",        required_argument, 0, 'T'},
     {"initrd",     required_argument, 0, 'i'},
+    {"huge-pages", no_argument,       0, 'H'},
+    {"decode-cache", required_argument, 0, 'd'},
+    {"poll-skip",  required_argument, 0, 'L'},
+    {"block-exec", required_argument, 0, 'x'},
+    {"dbt",        required_argument, 0, 'X'},
+    {"tlb-sets",   required_argument, 0, 'u'},
+    {"tlb-ways",   required_argument, 0, 'w'},
+    {"harts",      required_argument, 0, 'n'},
+    {"quantum",    required_argument, 0, 'q'},
     {"help",       no_argument,       0, 'h'},
     {0, 0, 0, 0}
 };
@@ -66,6 +76,15 @@ static void help_options(void)
     fprintf (stderr,"  --vda        | -V FILE       Disk image for VirtIO block device (/dev/vda)\n");
     fprintf (stderr,"  --tap        | -T TAP        Tap device for VirtIO net device\n");
     fprintf (stderr,"  --initrd     | -i FILE       initrd binary (optional)\n");
+    fprintf (stderr,"  --huge-pages | -H            Back memory with transparent huge pages (default: off)\n");
+    fprintf (stderr,"  --decode-cache | -d 1/0      Pre-decoded instruction cache (default: 1)\n");
+    fprintf (stderr,"  --poll-skip  | -L 1/0        Skip time in MMIO busy-poll loops (default: 0)\n");
+    fprintf (stderr,"  --block-exec | -x 1/0        Superblock execution with block chaining (default: 0)\n");
+    fprintf (stderr,"  --dbt        | -X 1/0        Translate hot RV64 code to x86-64 (default: 0)\n");
+    fprintf (stderr,"  --tlb-sets   | -u num        TLB sets (per I/D TLB, default: 64)\n");
+    fprintf (stderr,"  --tlb-ways   | -w num        TLB ways (default: 4)\n");
+    fprintf (stderr,"  --harts      | -n num        Number of harts, one host thread each (default: 1)\n");
+    fprintf (stderr,"  --quantum    | -q num        Run harts round robin on one thread, num steps per turn (deterministic, default: 0 = off)\n");
     exit(-1);
 }
 //-----------------------------------------------------------------
@@ -85,7 +104,6 @@ static void sigint_handler(int s)
 //-----------------------------------------------------------------
 int main(int argc, char *argv[])
 {
-    uint64_t       cycles         = 0;
     int64_t        max_cycles     = (int64_t)-1;
     const char *   filename       = NULL;
     bool           is_binary      = false;
@@ -101,6 +119,15 @@ int main(int argc, char *argv[])
     const char *   vda_file       = NULL;
     const char *   tap_device     = NULL;
     const char *   initrd_filename= NULL;
+    bool           huge_pages     = false;
+    int            decode_cache   = 1;
+    int            poll_skip      = 0;
+    int            block_exec     = 0;
+    int            dbt            = 0;
+    int            tlb_sets       = TLB_SETS_DEFAULT;
+    int            tlb_ways       = TLB_WAYS_DEFAULT;
+    int            harts          = 1;
+    uint64_t       quantum        = 0;
     int c;
 
     int option_index = 0;
@@ -149,6 +176,33 @@ int main(int argc, char *argv[])
             case 'i':
                 initrd_filename = optarg;
                 break;
+            case 'H':
+                huge_pages = true;
+                break;
+            case 'd':
+                decode_cache = strtoul(optarg, NULL, 0);
+                break;
+            case 'L':
+                poll_skip = strtoul(optarg, NULL, 0);
+                break;
+            case 'x':
+                block_exec = strtoul(optarg, NULL, 0);
+                break;
+            case 'X':
+                dbt = strtoul(optarg, NULL, 0);
+                break;
+            case 'u':
+                tlb_sets = strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                tlb_ways = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                harts = strtoul(optarg, NULL, 0);
+                break;
+            case 'q':
+                quantum = strtoull(optarg, NULL, 0);
+                break;
             case '?':
             default:
                 help = 1;   
@@ -156,7 +210,7 @@ int main(int argc, char *argv[])
         }
     }
 
-    if (help || (filename == NULL || device_blob == NULL))
+    if (help || (filename == NULL || device_blob == NULL) || harts < 1)
         help_options();
 
     console_io *con = new console();
@@ -170,6 +224,12 @@ int main(int argc, char *argv[])
     if (!sim)
         return -1;
     sim->set_console(con);
+    sim->enable_huge_pages(huge_pages);
+    sim->enable_decode_cache(decode_cache != 0);
+    sim->enable_poll_skip(poll_skip != 0);
+    sim->enable_block_exec(block_exec != 0);
+    sim->enable_dbt(dbt != 0);
+    sim->configure_tlb(tlb_sets, tlb_ways);
 
     // Get memory
     uint32_t mem_base = plat->get_mem_base();
@@ -220,7 +280,7 @@ int main(int argc, char *argv[])
             load_offset = 0xC0000000 - mem_base;
 
         elf_load elf(filename, sim, false, -load_offset);
-        if (!elf.load())
+        if (!elf.load_segments(true))
         {
             fprintf (stderr,"Error: Could not open %s\n", filename);
             return -1;
@@ -258,9 +318,33 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    // Additional harts (sharing memory and devices with hart 0),
+    // these wait to be started via SBI HSM
+    smp cores;
+    cores.set_quantum(quantum);
+    cores.add_hart(sim);
+    for (int i=1;i<harts;i++)
+    {
+        cpu *hart = plat->create_hart(i);
+        if (!hart)
+        {
+            fprintf (stderr,"Error: Platform does not support multiple harts\n");
+            return -1;
+        }
+
+        hart->set_console(con);
+        hart->enable_decode_cache(decode_cache != 0);
+        hart->enable_poll_skip(poll_skip != 0);
+        hart->enable_block_exec(block_exec != 0);
+        hart->enable_dbt(dbt != 0);
+        hart->configure_tlb(tlb_sets, tlb_ways);
+        hart->reset(mem_base);
+        cores.add_hart(hart, false);
+    }
+
     // Setup SBI
     sim->reset(mem_base);
-    sbi::setup(sim, con, mem_base, dtb_base);
+    sbi::setup(sim, con, mem_base, dtb_base, &cores);
 
     // User specified virtio block device file
     int vda_idx = 0;
@@ -297,34 +381,31 @@ int main(int argc, char *argv[])
 
     // Enable trace?
     if (trace)
-        sim->enable_trace(trace_mask);
-
-    cycles = 0;
+        for (int i=0;i<harts;i++)
+            cores.get_hart(i)->enable_trace(trace_mask);
 
     // Catch SIGINT to restore terminal settings on exit
     signal(SIGINT, sigint_handler);
 
-    uint32_t current_pc = 0;
-    while (!sim->get_fault() && !sim->get_stopped() && current_pc != stop_pc && !m_user_abort)
-    {
-        current_pc = sim->get_pc();
-        sim->step();
-        cycles++;
-
-        if (max_cycles != (int64_t)-1 && max_cycles == cycles)
-            break;
+    run_limits limits;
+    limits.stop_pc       = stop_pc;
+    limits.trace_pc      = trace_pc;
+    limits.trace_mask    = trace_mask;
+    limits.stop_on_break = false;
+    limits.abort         = &m_user_abort;
 
-        // Turn trace on
-        if (trace_pc == current_pc)
-            sim->enable_trace(trace_mask);
-    }
+    cores.run((max_cycles != (int64_t)-1) ? (uint64_t)max_cycles : RUN_FOREVER, limits);
 
     // Fault occurred?
-    if (sim->get_fault())
-        return 1;
-    else
+    for (int i=0;i<harts;i++)
+        if (cores.get_hart(i)->get_fault())
+            return 1;
+
+    for (int i=0;i<harts;i++)
     {
-        sim->stats_dump();
-        return 0;
+        if (harts > 1)
+            printf("Hart %d:\n", i);
+        cores.get_hart(i)->stats_dump();
     }
+    return 0;
 }
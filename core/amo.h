@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#ifndef __AMO_H__
+#define __AMO_H__
+
+#include <stdint.h>
+#include <vector>
+
+//--------------------------------------------------------------------
+// AMO operations
+//--------------------------------------------------------------------
+enum amo_op
+{
+    AMO_SWAP,
+    AMO_ADD,
+    AMO_XOR,
+    AMO_AND,
+    AMO_OR,
+    AMO_MIN,
+    AMO_MAX,
+    AMO_MINU,
+    AMO_MAXU
+};
+
+// Value to write back (T: unsigned type, S: signed equivalent)
+template <typename T, typename S>
+static inline T amo_apply(int op, T old, T src)
+{
+    switch (op)
+    {
+        case AMO_ADD:  return old + src;
+        case AMO_XOR:  return old ^ src;
+        case AMO_AND:  return old & src;
+        case AMO_OR:   return old | src;
+        case AMO_MIN:  return ((S)old < (S)src) ? old : src;
+        case AMO_MAX:  return ((S)old > (S)src) ? old : src;
+        case AMO_MINU: return (old < src) ? old : src;
+        case AMO_MAXU: return (old > src) ? old : src;
+        default:       return src;
+    }
+}
+
+// Atomic read-modify-write of (aligned) host memory, returns old value
+template <typename T, typename S>
+static inline T amo_host(T *p, int op, T src)
+{
+    switch (op)
+    {
+        case AMO_SWAP: return __atomic_exchange_n(p, src, __ATOMIC_SEQ_CST);
+        case AMO_ADD:  return __atomic_fetch_add(p, src, __ATOMIC_SEQ_CST);
+        case AMO_XOR:  return __atomic_fetch_xor(p, src, __ATOMIC_SEQ_CST);
+        case AMO_AND:  return __atomic_fetch_and(p, src, __ATOMIC_SEQ_CST);
+        case AMO_OR:   return __atomic_fetch_or(p, src, __ATOMIC_SEQ_CST);
+        default:
+        {
+            T old = __atomic_load_n(p, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(p, &old, amo_apply<T,S>(op, old, src), true,
+                                                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                ;
+            return old;
+        }
+    }
+}
+
+//--------------------------------------------------------------------
+// Defaults
+//--------------------------------------------------------------------
+#define RESV_LINE_SHIFT     6   // Reservation granule (cache line)
+
+//--------------------------------------------------------------------
+// reservation_table: LR/SC reservations of harts sharing memory.
+// Each hart holds at most one, covering a cache line; a store to
+// that line by another hart drops it. Stores only scan the table
+// while a reservation is held.
+//--------------------------------------------------------------------
+class reservation_table
+{
+public:
+    reservation_table() { m_active = 0; }
+
+    // Make room for a hart (before the harts run)
+    void attach(uint32_t hart)
+    {
+        if (hart >= m_line.size())
+            m_line.resize(hart + 1, 0);
+    }
+
+    void reserve(uint32_t hart, uint64_t addr)
+    {
+        if (__atomic_exchange_n(&m_line[hart], line(addr), __ATOMIC_SEQ_CST) == 0)
+            __atomic_add_fetch(&m_active, 1, __ATOMIC_SEQ_CST);
+    }
+
+    bool held(uint32_t hart, uint64_t addr)
+    {
+        return __atomic_load_n(&m_line[hart], __ATOMIC_SEQ_CST) == line(addr);
+    }
+
+    void clear(uint32_t hart)
+    {
+        if (__atomic_exchange_n(&m_line[hart], 0, __ATOMIC_SEQ_CST) != 0)
+            __atomic_sub_fetch(&m_active, 1, __ATOMIC_SEQ_CST);
+    }
+
+    // Store by hart to addr
+    void store(uint32_t hart, uint64_t addr)
+    {
+        if (__atomic_load_n(&m_active, __ATOMIC_RELAXED))
+            invalidate(hart, line(addr));
+    }
+
+private:
+    // Line number + 1 (0 = no reservation)
+    static uint64_t line(uint64_t addr) { return (addr >> RESV_LINE_SHIFT) + 1; }
+
+    void invalidate(uint32_t hart, uint64_t l)
+    {
+        for (uint32_t i=0;i<m_line.size();i++)
+        {
+            uint64_t expected = l;
+            if (i != hart && __atomic_load_n(&m_line[i], __ATOMIC_RELAXED) == l &&
+                __atomic_compare_exchange_n(&m_line[i], &expected, 0, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                __atomic_sub_fetch(&m_active, 1, __ATOMIC_SEQ_CST);
+        }
+    }
+
+    std::vector<uint64_t> m_line;
+    uint32_t              m_active;
+};
+
+#endif
@@ -47,21 +47,10 @@ bool bin_load::load(uint32_t mem_base, uint32_t mem_size)
 
             if (!m_target->create_memory(mem_base, mem_size))
                 fprintf (stderr,"Error: Could not allocate memory\n");
+            else if (!m_target->write_block(mem_base, buf, len))
+                fprintf (stderr,"Error: Could not load image to memory\n");
             else
-            {
                 error = 0;
-                for (int i=0;i<len;i++)
-                {
-                    if (m_target->valid_addr(mem_base + i))
-                        m_target->write(mem_base + i, buf[i]);
-                    else
-                    {
-                        fprintf (stderr,"Error: Could not load image to memory\n");
-                        error = 1;
-                        break;
-                    }
-                }
-            }
 
             free(buf);
             fclose(f);
@@ -99,18 +88,10 @@ bool bin_load::load(uint32_t mem_base)
             // Read file data in
             int len = fread(buf, 1, size, f);
 
-            error = 0;
-            for (int i=0;i<len;i++)
-            {
-                if (m_target->valid_addr(mem_base + i))
-                    m_target->write(mem_base + i, buf[i]);
-                else
-                {
-                    fprintf (stderr,"Error: Could not load image to memory\n");
-                    error = 1;
-                    break;
-                }
-            }
+            if (!m_target->write_block(mem_base, buf, len))
+                fprintf (stderr,"Error: Could not load image to memory\n");
+            else
+                error = 0;
 
             free(buf);
             fclose(f);
@@ -19,6 +19,16 @@ cpu::cpu()
 {
     m_memories           = NULL;
     m_devices            = NULL;
+    m_sched.now          = 0;
+    m_sched.next         = 0;
+    m_sched.events       = 0;
+    m_time               = &m_sched;
+    m_poll_skip          = false;
+    m_poll.valid         = false;
+    m_poll_period        = 0;
+    m_horizon            = ~(uint64_t)0;
+    m_horizon_reached    = NULL;
+    skip_stats_reset();
     m_console            = NULL;
     m_has_breakpoints    = false;
     m_stopped            = false;
@@ -26,6 +36,14 @@ cpu::cpu()
     m_break              = false;
     m_trace              = 0;
     m_syscall_if         = NULL;
+    m_hartid             = 0;
+    m_bus_lock           = NULL;
+    m_posted_irq         = 0;
+    m_posted_fence       = 0;
+    m_resv               = NULL;
+
+    memset(m_mem_map, 0, sizeof(m_mem_map));
+    m_huge_pages         = false;
 }
 //-----------------------------------------------------------------
 // error: Handle an error
@@ -53,7 +71,25 @@ bool cpu::create_memory(uint32_t baseAddr, uint32_t len, uint8_t *buf /*=NULL*/)
         if (mem->valid_addr(baseAddr) && mem->valid_addr(baseAddr + len -1))
             return true;
 
-    return attach_memory(new memory("mem", baseAddr, len, buf));
+    // Caller provided buffer
+    if (buf)
+        return attach_memory(new memory("mem", baseAddr, len, buf));
+
+    // Lazily allocated RAM
+    return attach_memory(new memory_mmap("mem", baseAddr, len, m_huge_pages));
+}
+//-----------------------------------------------------------------
+// create_memory_file: Create a memory region mapping a file (copy on write)
+//-----------------------------------------------------------------
+bool cpu::create_memory_file(uint32_t baseAddr, uint32_t len, int fd, uint64_t offset)
+{
+    // Only for otherwise unmapped ranges
+    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
+        if ((uint64_t)baseAddr < ((uint64_t)mem->get_base() + mem->get_size()) &&
+            (uint64_t)mem->get_base() < ((uint64_t)baseAddr + len))
+            return false;
+
+    return attach_memory(new memory_mmap("mem", baseAddr, len, fd, offset));
 }
 //-----------------------------------------------------------------
 // attach_memory: Attach a memory device to a particular region
@@ -66,25 +102,169 @@ bool cpu::attach_memory(memory_base *memory)
     m_memories = memory;
     memory->reset();
 
+    mem_map_update(memory);
+
     return true;
 }
 //-----------------------------------------------------------------
+// mem_map_update: Refresh page dispatch entries covered by a region
+//-----------------------------------------------------------------
+void cpu::mem_map_update(memory_base *memory)
+{
+    const uint64_t page_size = 1ull << MEM_MAP_PAGE_SHIFT;
+
+    if (memory->get_size() == 0)
+        return ;
+
+    uint64_t first = memory->get_base() >> MEM_MAP_PAGE_SHIFT;
+    uint64_t last  = ((uint64_t)memory->get_base() + memory->get_size() - 1) >> MEM_MAP_PAGE_SHIFT;
+    if (last >= (1ull << (32 - MEM_MAP_PAGE_SHIFT)))
+        last = (1ull << (32 - MEM_MAP_PAGE_SHIFT)) - 1;
+
+    for (uint64_t page = first; page <= last; page++)
+    {
+        uint64_t page_base = page << MEM_MAP_PAGE_SHIFT;
+        uint64_t page_end  = page_base + page_size - 1;
+
+        // Only pages owned by a single region can be dispatched directly
+        memory_base *owner = NULL;
+        int          count = 0;
+        for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
+        {
+            uint64_t mem_base = mem->get_base();
+            uint64_t mem_end  = mem_base + mem->get_size() - 1;
+
+            if (mem->get_size() && mem_base <= page_end && mem_end >= page_base)
+            {
+                owner = mem;
+                count++;
+            }
+        }
+
+        mem_page *&map = m_mem_map[page >> (MEM_MAP_L1_SHIFT - MEM_MAP_PAGE_SHIFT)];
+        if (!map)
+        {
+            map = new mem_page[MEM_MAP_L2_ENTRIES];
+            memset(map, 0, sizeof(mem_page) * MEM_MAP_L2_ENTRIES);
+        }
+
+        mem_page &entry = map[page & (MEM_MAP_L2_ENTRIES-1)];
+        entry.mem  = (count == 1) ? owner : NULL;
+        entry.dev  = NULL;
+        entry.host = (count == 1) ? owner->get_host_ptr(page_base, page_size) : NULL;
+
+        for (device *dev = m_devices; dev != NULL && entry.mem; dev = dev->device_next)
+            if (dev == entry.mem)
+                entry.dev = dev;
+    }
+}
+//-----------------------------------------------------------------
+// find_memory_slow: Search all regions for a physical address
+//-----------------------------------------------------------------
+memory_base * cpu::find_memory_slow(uint32_t address)
+{
+    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
+        if (mem->valid_addr(address))
+        {
+            for (device *dev = m_devices; dev != NULL; dev = dev->device_next)
+                if (dev == mem)
+                    dev->clock_rearm();
+            return mem;
+        }
+
+    return NULL;
+}
+//-----------------------------------------------------------------
 // attach_memory: Attach a memory device to a particular region
 //-----------------------------------------------------------------
 bool cpu::attach_device(device *dev)
 {
-    // Devices are memory mapped
-    attach_memory(dev);
-
     assert(dev->device_next == NULL);
 
     dev->device_next = m_devices;
     m_devices = dev;
+
+    dev->attach_scheduler(&m_sched);
+    dev->clock_rearm();
+
+    // Devices are memory mapped
+    attach_memory(dev);
     dev->reset();
 
     return true;
 }
 //-----------------------------------------------------------------
+// share_memory: Use the memories (and mapped devices) of another hart
+//-----------------------------------------------------------------
+void cpu::share_memory(cpu *owner)
+{
+    assert(m_memories == NULL && m_devices == NULL);
+
+    // Devices stay attached to (and are clocked by) the owner
+    m_memories = owner->m_memories;
+    for (int i=0;i<MEM_MAP_L1_ENTRIES;i++)
+        m_mem_map[i] = owner->m_mem_map[i];
+
+    // LR/SC reservations are tracked once memory is shared
+    if (!owner->m_resv)
+    {
+        owner->m_resv = new reservation_table();
+        owner->m_resv->attach(owner->m_hartid);
+    }
+    m_resv = owner->m_resv;
+    m_resv->attach(m_hartid);
+
+    // One time base for all harts (that of the CLINT / devices)
+    m_time = &owner->m_sched;
+}
+//-----------------------------------------------------------------
+// post_interrupt: Raise / drop an interrupt from another thread
+// (the last request for an interrupt wins)
+//-----------------------------------------------------------------
+void cpu::post_interrupt(int irq, bool raise)
+{
+    uint64_t set = ((uint64_t)1) << (irq + (raise ? 0 : 32));
+    uint64_t clr = ((uint64_t)1) << (irq + (raise ? 32 : 0));
+    uint64_t val = __atomic_load_n(&m_posted_irq, __ATOMIC_RELAXED);
+
+    while (!__atomic_compare_exchange_n(&m_posted_irq, &val, (val & ~clr) | set, true,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        ;
+
+    // Clock devices (and so pick this up) on the next step
+    m_sched.rearm();
+}
+//-----------------------------------------------------------------
+// post_fence: Request fences from another thread (see fence_pending)
+//-----------------------------------------------------------------
+void cpu::post_fence(uint32_t fences)
+{
+    __atomic_or_fetch(&m_posted_fence, fences, __ATOMIC_SEQ_CST);
+    m_sched.rearm();
+}
+//-----------------------------------------------------------------
+// poll_posted: Apply requests posted by other harts
+//-----------------------------------------------------------------
+void cpu::poll_posted(void)
+{
+    uint64_t irqs = __atomic_exchange_n(&m_posted_irq, 0, __ATOMIC_SEQ_CST);
+    for (int i=0;irqs && i<32;i++)
+    {
+        if (irqs & (((uint64_t)1) << i))
+            set_interrupt(i);
+        else if (irqs & (((uint64_t)1) << (i + 32)))
+            clr_interrupt(i);
+    }
+
+    // Requester waits until the fence bits clear (after the fence)
+    uint32_t fences = __atomic_load_n(&m_posted_fence, __ATOMIC_ACQUIRE);
+    if (fences)
+    {
+        remote_fence(fences);
+        __atomic_and_fetch(&m_posted_fence, ~fences, __ATOMIC_SEQ_CST);
+    }
+}
+//-----------------------------------------------------------------
 // get_break: Get breakpoint status (and clear)
 //-----------------------------------------------------------------
 bool cpu::get_break(void)
@@ -133,23 +313,19 @@ bool cpu::check_breakpoint(uint32_t pc)
 //-----------------------------------------------------------------
 bool cpu::valid_addr(uint32_t address)
 {
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-            return true;
-
-    return false;
+    return find_memory(address) != NULL;
 }
 //-----------------------------------------------------------------
 // write: Write a byte to memory (physical address)
 //-----------------------------------------------------------------
 void cpu::write(uint32_t address, uint8_t data)
 {
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            mem->write8(address, data);
-            return ;
-        }
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        mem->write8(address, data);
+        return ;
+    }
 
     error(false, "Failed store @ 0x%08x\n", address);
 }
@@ -158,15 +334,114 @@ void cpu::write(uint32_t address, uint8_t data)
 //-----------------------------------------------------------------
 uint8_t cpu::read(uint32_t address)
 {
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        uint8_t data = 0;
+        mem->read8(address, data);
+        return data;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------
+// write_block: Write a block of data to memory (physical address)
+//-----------------------------------------------------------------
+bool cpu::write_block(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    while (length > 0)
+    {
+        memory_base *mem = find_memory(address);
+        if (!mem)
         {
-            uint8_t data = 0;
-            mem->read8(address, data);
-            return data;
+            error(false, "Failed store @ 0x%08x\n", address);
+            return false;
         }
 
-    return 0;
+        // Contiguous span within this region
+        uint32_t span = mem->get_base() + mem->get_size() - address;
+        if (span == 0 || span > length)
+            span = length;
+
+        uint8_t *host = mem->get_host_ptr(address, span);
+        if (host)
+            memcpy(host, data, span);
+        else if (!mem->write_block(address, (uint8_t*)data, span))
+            return false;
+
+        address += span;
+        data    += span;
+        length  -= span;
+    }
+
+    return true;
+}
+//-----------------------------------------------------------------
+// zero_block: Clear a block of memory (physical address)
+//-----------------------------------------------------------------
+bool cpu::zero_block(uint32_t address, uint32_t length)
+{
+    while (length > 0)
+    {
+        memory_base *mem = find_memory(address);
+        if (!mem)
+        {
+            error(false, "Failed store @ 0x%08x\n", address);
+            return false;
+        }
+
+        // Contiguous span within this region
+        uint32_t span = mem->get_base() + mem->get_size() - address;
+        if (span == 0 || span > length)
+            span = length;
+
+        if (!mem->zero_block(address, span))
+            return false;
+
+        address += span;
+        length  -= span;
+    }
+
+    return true;
+}
+//-----------------------------------------------------------------
+// read_block: Read a block of data from memory (physical address)
+//-----------------------------------------------------------------
+bool cpu::read_block(uint32_t address, uint8_t *data, uint32_t length)
+{
+    bool res = true;
+
+    while (length > 0)
+    {
+        uint32_t span = 1;
+
+        memory_base *mem = find_memory(address);
+        if (mem)
+        {
+            // Contiguous span within this region
+            span = mem->get_base() + mem->get_size() - address;
+            if (span == 0 || span > length)
+                span = length;
+
+            uint8_t *host = mem->get_host_ptr(address, span);
+            if (host)
+                memcpy(data, host, span);
+            else
+                res &= mem->read_block(address, data, span);
+        }
+        // Unmapped reads return 0
+        else
+        {
+            *data = 0;
+            res   = false;
+        }
+
+        address += span;
+        data    += span;
+        length  -= span;
+    }
+
+    return res;
 }
 //-----------------------------------------------------------------
 // write16: Write a word to memory (physical address)
@@ -175,12 +450,19 @@ void cpu::write16(uint32_t address, uint16_t data)
 {
     address &= ~1;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            mem->write16(address, data);
-            return ;
-        }
+    uint8_t *host = find_host_page(address, 2);
+    if (host)
+    {
+        memcpy(host, &data, sizeof(data));
+        return ;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        mem->write16(address, data);
+        return ;
+    }
 
     error(false, "Failed store @ 0x%08x\n", address);
 }
@@ -191,13 +473,21 @@ uint16_t cpu::read16(uint32_t address)
 {
     address &= ~1;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            uint16_t data = 0;
-            mem->read16(address, data);
-            return data;
-        }
+    uint8_t *host = find_host_page(address, 2);
+    if (host)
+    {
+        uint16_t data;
+        memcpy(&data, host, sizeof(data));
+        return data;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        uint16_t data = 0;
+        mem->read16(address, data);
+        return data;
+    }
 
     return 0;
 }
@@ -208,12 +498,19 @@ void cpu::write32(uint32_t address, uint32_t data)
 {
     address &= ~3;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            mem->write32(address, data);
-            return ;
-        }
+    uint8_t *host = find_host_page(address, 4);
+    if (host)
+    {
+        memcpy(host, &data, sizeof(data));
+        return ;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        mem->write32(address, data);
+        return ;
+    }
 
     error(false, "Failed store @ 0x%08x\n", address);
 }
@@ -224,13 +521,69 @@ uint32_t cpu::read32(uint32_t address)
 {
     address &= ~3;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            uint32_t data = 0;
-            mem->read32(address, data);
-            return data;
-        }
+    uint8_t *host = find_host_page(address, 4);
+    if (host)
+    {
+        uint32_t data;
+        memcpy(&data, host, sizeof(data));
+        return data;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        uint32_t data = 0;
+        mem->read32(address, data);
+        return data;
+    }
+
+    return 0;
+}
+//-----------------------------------------------------------------
+// write64: Write a double word to memory (physical address)
+//-----------------------------------------------------------------
+void cpu::write64(uint32_t address, uint64_t data)
+{
+    address &= ~7;
+
+    uint8_t *host = find_host_page(address, 8);
+    if (host)
+    {
+        memcpy(host, &data, sizeof(data));
+        return ;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        mem->write64(address, data);
+        return ;
+    }
+
+    error(false, "Failed store @ 0x%08x\n", address);
+}
+//-----------------------------------------------------------------
+// read64: Read a double word from memory (physical address)
+//-----------------------------------------------------------------
+uint64_t cpu::read64(uint32_t address)
+{
+    address &= ~7;
+
+    uint8_t *host = find_host_page(address, 8);
+    if (host)
+    {
+        uint64_t data;
+        memcpy(&data, host, sizeof(data));
+        return data;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        uint64_t data = 0;
+        mem->read64(address, data);
+        return data;
+    }
 
     return 0;
 }
@@ -241,13 +594,21 @@ uint32_t cpu::ifetch32(uint32_t address)
 {
     address &= ~3;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            uint32_t data = 0;
-            mem->ifetch32(address, data);
-            return data;
-        }
+    uint8_t *host = find_host_page(address, 4);
+    if (host)
+    {
+        uint32_t data;
+        memcpy(&data, host, sizeof(data));
+        return data;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        uint32_t data = 0;
+        mem->ifetch32(address, data);
+        return data;
+    }
 
     return 0;
 }
@@ -258,13 +619,21 @@ uint16_t cpu::ifetch16(uint32_t address)
 {
     address &= ~1;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            uint16_t data = 0;
-            mem->ifetch16(address, data);
-            return data;
-        }
+    uint8_t *host = find_host_page(address, 2);
+    if (host)
+    {
+        uint16_t data;
+        memcpy(&data, host, sizeof(data));
+        return data;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        uint16_t data = 0;
+        mem->ifetch16(address, data);
+        return data;
+    }
 
     return 0;
 }
@@ -277,16 +646,191 @@ void cpu::step(void)
     if (m_has_breakpoints && check_breakpoint(get_pc()))
         m_break = true;
 
-    // Clock peripherals
+    // Clock peripherals (only when one is due)
+    uint64_t now = m_sched.now + 1;
+    m_sched.store_now(now);
+    if (now >= m_sched.load_next())
+        clock_devices();
+
+    // Busy-poll loop found this step
+    if (m_poll_period)
+        poll_skip();
+}
+//-----------------------------------------------------------------
+// clock_devices: Clock devices which are due and find next deadline
+//-----------------------------------------------------------------
+void cpu::clock_devices(void)
+{
+    uint64_t now = m_sched.now;
+
+    bus_guard guard(m_bus_lock);
+
+    // Requests from other harts
+    if (posted())
+        poll_posted();
+
+    // NOTE: Devices re-armed during this pass will pull this back to 0
+    m_sched.store_next(~(uint64_t)0);
+
     for (device *dev = m_devices; dev != NULL; dev = dev->device_next)
     {
-        dev->clock();
+        if (dev->clock_deadline <= now)
+        {
+            // Deadline reached (rather than re-armed by an access)
+            if (dev->clock_deadline)
+                m_sched.events++;
+
+            int delta = dev->clock();
+            dev->clock_deadline = now + (delta > 1 ? delta : 1);
 
-        if (dev->event_irq_raised())
-            set_interrupt(dev->get_irq_num());
-        else if (dev->event_irq_dropped())
-            clr_interrupt(dev->get_irq_num());
+            if (dev->event_irq_raised())
+            {
+                set_interrupt(dev->get_irq_num());
+
+                // Any drop event is picked up on the next step
+                dev->clock_rearm();
+            }
+            else if (dev->event_irq_dropped())
+                clr_interrupt(dev->get_irq_num());
+        }
+
+        if (dev->clock_deadline < m_sched.load_next())
+            m_sched.store_next(dev->clock_deadline);
     }
+
+    // A request posted during this pass must not be lost
+    if (m_bus_lock)
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (posted())
+            m_sched.rearm();
+    }
+}
+//-----------------------------------------------------------------
+// idle: Fast-forward time to the step before the next event
+//-----------------------------------------------------------------
+void cpu::idle(uint64_t until)
+{
+    // Stop short of the next device deadline so cpu::step() clocks it
+    uint64_t next = m_sched.load_next();
+    if (next != ~(uint64_t)0)
+    {
+        uint64_t last = next ? (next - 1) : 0;
+        if (last < until)
+            until = last;
+    }
+
+    // Not beyond the end of this hart's quantum
+    if (until > m_horizon)
+        until = m_horizon;
+
+    // Nothing will ever wake the CPU (or an event is already due)
+    if (until == ~(uint64_t)0 || until <= m_sched.now)
+        return ;
+
+    m_idle_steps += until - m_sched.now;
+    m_sched.store_now(until);
+    horizon_check();
+}
+//-----------------------------------------------------------------
+// poll_detect: Look for a loop re-reading an MMIO register.
+// A loop is found when the same load sees the same value with the
+// same register state and no side effects since the last iteration.
+//-----------------------------------------------------------------
+void cpu::poll_detect(uint64_t pc, uint32_t addr, uint64_t value, const void *state, int len)
+{
+    // Traces show every retired instruction
+    if (!m_poll_skip || m_trace)
+        return ;
+
+    assert(len <= POLL_STATE_MAX);
+
+    uint64_t period = m_sched.now - m_poll.step;
+    if (m_poll.valid && period <= POLL_MAX_PERIOD)
+    {
+        // Another load in the same loop body
+        if (m_poll.pc != pc || m_poll.addr != addr)
+            return ;
+
+        // No device deadline in the last iteration, nothing else changed
+        if (period != 0 && m_poll.value == value && m_poll.events == m_sched.events &&
+            !memcmp(m_poll.state, state, len))
+            m_poll_period = period;
+    }
+
+    m_poll.valid  = true;
+    m_poll.pc     = pc;
+    m_poll.addr   = addr;
+    m_poll.value  = value;
+    m_poll.step   = m_sched.now;
+    m_poll.events = m_sched.events;
+    memcpy(m_poll.state, state, len);
+}
+//-----------------------------------------------------------------
+// poll_skip: Skip whole iterations of a busy-poll loop up to the
+// step before the next device / timer event
+//-----------------------------------------------------------------
+void cpu::poll_skip(void)
+{
+    uint64_t period = m_poll_period;
+    m_poll_period   = 0;
+
+    // A device deadline was reached this step - register may have changed
+    if (m_poll.events != m_sched.events)
+        return ;
+
+    uint64_t until = timer_event();
+    uint64_t next = m_sched.load_next();
+    if (next != ~(uint64_t)0)
+    {
+        uint64_t last = next ? (next - 1) : 0;
+        if (last < until)
+            until = last;
+    }
+
+    if (until > m_horizon)
+        until = m_horizon;
+
+    if (until == ~(uint64_t)0 || until <= m_sched.now)
+        return ;
+
+    uint64_t skip = ((until - m_sched.now) / period) * period;
+    if (skip == 0)
+        return ;
+
+    m_sched.store_now(m_sched.now + skip);
+    m_poll.step  += skip;
+    m_poll_loops++;
+    m_poll_steps += skip;
+    horizon_check();
+}
+//-----------------------------------------------------------------
+// horizon_check: End the current quantum once time has been
+// skipped up to its horizon
+//-----------------------------------------------------------------
+void cpu::horizon_check(void)
+{
+    if (m_horizon_reached && m_sched.now >= m_horizon)
+        __atomic_store_n(m_horizon_reached, true, __ATOMIC_RELAXED);
+}
+//-----------------------------------------------------------------
+// skip_stats_dump: Report time skipped (idle / busy-poll loops)
+//-----------------------------------------------------------------
+void cpu::skip_stats_dump(void)
+{
+    if (m_idle_steps)
+        printf( "- Idle (WFI) steps skipped %llu\n", (unsigned long long)m_idle_steps);
+    if (m_poll_loops)
+        printf( "- Poll loops skipped %llu (%llu steps)\n", (unsigned long long)m_poll_loops, (unsigned long long)m_poll_steps);
+}
+//-----------------------------------------------------------------
+// skip_stats_reset: Reset time skipping stats
+//-----------------------------------------------------------------
+void cpu::skip_stats_reset(void)
+{
+    m_idle_steps = 0;
+    m_poll_loops = 0;
+    m_poll_steps = 0;
 }
 //-----------------------------------------------------------------
 // find_device: Find device by name and index
@@ -10,11 +10,75 @@
 
 #include <stdint.h>
 #include <vector>
+#include <mutex>
 #include "memory.h"
+#include "memory_mmap.h"
 #include "device.h"
 #include "mem_api.h"
 #include "console_io.h"
 #include "syscall_if.h"
+#include "amo.h"
+
+//--------------------------------------------------------------------
+// Busy-poll loop detection
+//--------------------------------------------------------------------
+#define POLL_MAX_PERIOD     32          // Max steps per loop iteration
+#define POLL_STATE_MAX      (32 * 8)    // Max register state (bytes)
+
+//--------------------------------------------------------------------
+// Batch execution: stop conditions and reasons (see cpu::run)
+//--------------------------------------------------------------------
+struct run_limits
+{
+    run_limits()
+    {
+        stop_pc       = 0xFFFFFFFF;
+        trace_pc      = 0xFFFFFFFF;
+        trace_mask    = 0;
+        stop_on_break = true;
+        abort         = NULL;
+    }
+
+    uint32_t       stop_pc;       // Stop after the instruction at this PC
+    uint32_t       trace_pc;      // Enable trace_mask after this PC
+    uint32_t       trace_mask;
+    bool           stop_on_break; // Stop on breakpoint / ebreak
+    volatile bool *abort;         // Stop when set (e.g. by a signal handler)
+
+    // Set from another thread (or a signal handler)
+    bool aborted(void) const { return abort && __atomic_load_n(abort, __ATOMIC_RELAXED); }
+};
+
+enum run_reason
+{
+    RUN_LIMIT,      // Instruction budget exhausted
+    RUN_FAULT,
+    RUN_STOPPED,
+    RUN_STOP_PC,
+    RUN_BREAK,
+    RUN_ABORT
+};
+
+#define RUN_FOREVER     (~(uint64_t)0)
+
+//--------------------------------------------------------------------
+// Remote fences (see cpu::post_fence)
+//--------------------------------------------------------------------
+#define CPU_FENCE_I     (1 << 0)    // Instruction fetch (FENCE.I)
+#define CPU_FENCE_VMA   (1 << 1)    // Address translation (SFENCE.VMA)
+
+//--------------------------------------------------------------------
+// bus_guard: Hold the shared bus lock (if any) for the current scope
+//--------------------------------------------------------------------
+class bus_guard
+{
+public:
+    bus_guard(std::recursive_mutex *lock): m_lock(lock) { if (m_lock) m_lock->lock(); }
+    ~bus_guard() { if (m_lock) m_lock->unlock(); }
+
+private:
+    std::recursive_mutex *m_lock;
+};
 
 //--------------------------------------------------------------------
 // CPU model base class
@@ -26,9 +90,13 @@ public:
 
     // mem_api
     virtual bool      create_memory(uint32_t addr, uint32_t size, uint8_t *mem = NULL);
+    virtual bool      create_memory_file(uint32_t addr, uint32_t size, int fd, uint64_t offset);
     virtual bool      valid_addr(uint32_t addr);
     virtual void      write(uint32_t addr, uint8_t data);
     virtual uint8_t   read(uint32_t addr);
+    virtual bool      write_block(uint32_t addr, const uint8_t *data, uint32_t length);
+    virtual bool      zero_block(uint32_t addr, uint32_t length);
+    virtual bool      read_block(uint32_t addr, uint8_t *data, uint32_t length);
 
     // Memory access helpers
     virtual bool      attach_memory(memory_base *memory);
@@ -36,12 +104,48 @@ public:
     virtual uint16_t  read16(uint32_t address);    
     virtual void      write32(uint32_t address, uint32_t data);
     virtual uint32_t  read32(uint32_t address);
+    virtual void      write64(uint32_t address, uint64_t data);
+    virtual uint64_t  read64(uint32_t address);
     virtual uint32_t  ifetch32(uint32_t address);
     virtual uint16_t  ifetch16(uint32_t address);
 
+    // Find memory region mapped at physical address (or NULL)
+    memory_base *     find_memory(uint32_t address)
+    {
+        mem_page *map = m_mem_map[address >> MEM_MAP_L1_SHIFT];
+        if (map)
+        {
+            mem_page &entry  = map[(address >> MEM_MAP_PAGE_SHIFT) & (MEM_MAP_L2_ENTRIES-1)];
+            memory_base *mem = entry.mem;
+            if (mem && (address - mem->get_base()) < mem->get_size())
+            {
+                // Register access may change the device's next deadline
+                if (entry.dev)
+                    entry.dev->clock_rearm();
+                return mem;
+            }
+        }
+
+        return find_memory_slow(address);
+    }
+
+    // Host pointer for physical range [address, address+len) (or NULL if not RAM)
+    uint8_t *         get_host_ptr(uint32_t address, uint32_t len)
+    {
+        uint8_t *host = find_host_page(address, len);
+        if (host)
+            return host;
+
+        memory_base *mem = find_memory(address);
+        return mem ? mem->get_host_ptr(address, len) : NULL;
+    }
+
     // Attach peripherals
     virtual bool      attach_device(device * device);
 
+    // Request transparent huge pages for memories created after this call
+    void              enable_huge_pages(bool en) { m_huge_pages = en; }
+
     // Reset core to execute from specified PC
     virtual void      reset(uint32_t pc) = 0;
 
@@ -52,6 +156,9 @@ public:
     // Execute one instruction
     virtual void      step(void);
 
+    // Execute up to max_insts instructions (or until a stop condition)
+    virtual run_reason run(uint64_t max_insts, const run_limits &limits) = 0;
+
     // Breakpoints
     virtual bool      get_break(void);
     virtual bool      set_breakpoint(uint32_t pc);
@@ -95,6 +202,21 @@ public:
     // Instruction trace
     virtual void      enable_trace(uint32_t mask) { m_trace = mask; }
 
+    // Pre-decoded instruction cache (where supported by the CPU model)
+    virtual void      enable_decode_cache(bool en) { }
+
+    // Superblock execution with block chaining (where supported)
+    virtual void      enable_block_exec(bool en) { }
+
+    // Translate hot code to host instructions (where supported)
+    virtual void      enable_dbt(bool en) { }
+
+    // TLB geometry: sets x ways (where supported)
+    virtual void      configure_tlb(int sets, int ways) { }
+
+    // Skip time in busy-poll loops on MMIO registers (where supported)
+    void              enable_poll_skip(bool en) { m_poll_skip = en; m_poll.valid = false; }
+
     // Monitor executed instructions
     virtual void      log_exception(uint64_t src, uint64_t dst, uint64_t cause) { }
     virtual void      log_branch(uint64_t src, uint64_t dst, bool taken) { }
@@ -116,17 +238,188 @@ public:
     // Find device by name and index
     device *          find_device(std::string name, int idx);
 
+    // Multi-hart: hart ID (mhartid)
+    void              set_hartid(uint32_t id) { m_hartid = id; }
+    uint32_t          get_hartid(void)        { return m_hartid; }
+
+    // Multi-hart: share the physical memory map of another hart (which
+    // owns the devices). Must be called once all memories are created.
+    void              share_memory(cpu *owner);
+
+    // Multi-hart: serialise device accesses between harts (NULL = none)
+    void              set_bus_lock(std::recursive_mutex *lock) { m_bus_lock = lock; }
+
+    // Multi-hart: requests from other harts (any thread), which are
+    // picked up on this hart's next step
+    void              post_interrupt(int irq, bool raise);
+    void              post_fence(uint32_t fences);
+    bool              fence_pending(uint32_t fences)
+                      { return (__atomic_load_n(&m_posted_fence, __ATOMIC_ACQUIRE) & fences) != 0; }
+    void              poll_posted(void);
+
+    // Multi-hart: start executing at addr (a0 = hart ID, a1 = arg)
+    virtual void      boot_hart(uint32_t addr, uint64_t arg) { reset(addr); }
+
+    // Multi-hart: steps elapsed (align a hart being started with another)
+    uint64_t          get_steps(void) { return m_sched.now; }
+    void              sync_steps(uint64_t now) { if (now > m_sched.now) m_sched.store_now(now); }
+
+    // Multi-hart (quantum scheduling): idle / busy-poll skipping stops at
+    // step 'horizon' and sets *reached (passed to run() as the abort flag)
+    void              set_horizon(uint64_t horizon, bool *reached)
+                      { m_horizon = horizon; m_horizon_reached = reached; }
+    uint64_t          get_skipped_steps(void) { return m_idle_steps + m_poll_steps; }
+
+protected:
+    // Batch execution loop for CPU model T (step / get_pc bound statically)
+    template <class T>
+    run_reason          run_loop(T *c, uint64_t max_insts, const run_limits &limits)
+    {
+        while (!m_fault && !m_stopped && !limits.aborted())
+        {
+            if (max_insts-- == 0)
+                return RUN_LIMIT;
+
+            uint32_t pc = c->T::get_pc();
+            c->T::step();
+
+            if (pc == limits.trace_pc)
+                enable_trace(limits.trace_mask);
+
+            if (pc == limits.stop_pc)
+                return RUN_STOP_PC;
+
+            if (m_break && limits.stop_on_break)
+            {
+                m_break = false;
+                return RUN_BREAK;
+            }
+        }
+
+        return m_fault ? RUN_FAULT : m_stopped ? RUN_STOPPED : RUN_ABORT;
+    }
+
+    // Host pointer from the page map only (access must not cross a page)
+    uint8_t *           find_host_page(uint32_t address, uint32_t len)
+    {
+        mem_page *map    = m_mem_map[address >> MEM_MAP_L1_SHIFT];
+        uint32_t  offset = address & ((1 << MEM_MAP_PAGE_SHIFT) - 1);
+        if (map && (offset + len) <= (1 << MEM_MAP_PAGE_SHIFT))
+        {
+            uint8_t *host = map[(address >> MEM_MAP_PAGE_SHIFT) & (MEM_MAP_L2_ENTRIES-1)].host;
+            if (host)
+                return host + offset;
+        }
+
+        return NULL;
+    }
+
+    memory_base *       find_memory_slow(uint32_t address);
+    void                mem_map_update(memory_base *memory);
+
+    // Clock devices whose deadline has been reached
+    void                clock_devices(void);
+
+    // Wait for interrupt: skip idle steps up to the next device deadline
+    // (or step 'until', whichever is first)
+    void                idle(uint64_t until);
+    void                horizon_check(void);
+
+    // Step of the next CPU internal timer event (if any)
+    virtual uint64_t    timer_event(void) { return ~(uint64_t)0; }
+
+    // Shared time (steps of the device owner), and the step of this
+    // hart at which it is expected to reach 't' (now if already past)
+    uint64_t            time_now(void) { return m_time->load_now(); }
+    uint64_t            time_step(uint64_t t)
+    {
+        uint64_t now = time_now();
+        if (t == ~(uint64_t)0)
+            return t;
+        return m_sched.now + (t > now ? (t - now) : 0);
+    }
+
+    // Apply fences requested by other harts (CPU_FENCE_*)
+    virtual void        remote_fence(uint32_t fences) { }
+
+    bool                posted(void)
+    {
+        return __atomic_load_n(&m_posted_irq, __ATOMIC_ACQUIRE) ||
+               __atomic_load_n(&m_posted_fence, __ATOMIC_ACQUIRE);
+    }
+
+    // Store to shared memory: drop other harts' reservations on the line
+    void                resv_store(uint64_t physical)
+    {
+        if (m_resv)
+            m_resv->store(m_hartid, physical);
+    }
+
+    // Busy-poll detection: models report MMIO loads along with their
+    // register state, and any side effect (store, CSR write, trap).
+    void                poll_detect(uint64_t pc, uint32_t addr, uint64_t value, const void *state, int len);
+    void                poll_break(void) { m_poll.valid = false; }
+    void                poll_skip(void);
+
+    // Time skipping stats
+    void                skip_stats_dump(void);
+    void                skip_stats_reset(void);
+
 protected:
     // Memory
     memory_base        *m_memories;
     device             *m_devices;
 
+    // Physical page -> memory region dispatch (two level, 4KB pages).
+    // Pages shared by more than one region are left empty and are
+    // resolved by walking m_memories.
+    struct mem_page
+    {
+        memory_base    *mem;
+        device         *dev;   // mem if it is a device (or NULL)
+        uint8_t        *host;  // Host backing for the whole page (or NULL)
+    };
+    static const int    MEM_MAP_PAGE_SHIFT = 12;
+    static const int    MEM_MAP_L1_SHIFT   = 22;
+    static const int    MEM_MAP_L1_ENTRIES = 1 << (32 - MEM_MAP_L1_SHIFT);
+    static const int    MEM_MAP_L2_ENTRIES = 1 << (MEM_MAP_L1_SHIFT - MEM_MAP_PAGE_SHIFT);
+    mem_page           *m_mem_map[MEM_MAP_L1_ENTRIES];
+    bool                m_huge_pages;
+
     // Status
     bool                m_stopped;
     bool                m_fault;
     bool                m_break;
     int                 m_trace;
 
+    // Device scheduler
+    device_sched        m_sched;
+
+    // Time base: the device owner's step count (see share_memory)
+    device_sched       *m_time;
+
+    // Busy-poll detection (last MMIO load)
+    struct poll_state
+    {
+        bool            valid;
+        uint64_t        pc;
+        uint32_t        addr;
+        uint64_t        value;
+        uint64_t        step;
+        uint64_t        events;
+        uint8_t         state[POLL_STATE_MAX];
+    };
+    bool                m_poll_skip;
+    poll_state          m_poll;
+    uint64_t            m_poll_period;  // Loop found this step (0 = none)
+
+    // Time skipping stats
+    uint64_t            m_idle_steps;
+    uint64_t            m_poll_loops;
+    uint64_t            m_poll_steps;
+    uint64_t            m_horizon;
+    bool               *m_horizon_reached;
+
     // Breakpoints
     bool                m_has_breakpoints;
     std::vector <uint32_t > m_breakpoints;
@@ -136,6 +429,13 @@ protected:
 
     // System call hosting
     syscall_if         *m_syscall_if;
+
+    // Multi-hart
+    uint32_t            m_hartid;
+    std::recursive_mutex *m_bus_lock;
+    uint64_t            m_posted_irq;   // Raise [31:0], drop [63:32]
+    uint32_t            m_posted_fence;
+    reservation_table  *m_resv;         // LR/SC (NULL = single hart)
 };
 
 #endif
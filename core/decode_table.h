@@ -0,0 +1,92 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#ifndef __DECODE_TABLE_H__
+#define __DECODE_TABLE_H__
+
+#include <stdint.h>
+
+//--------------------------------------------------------------------
+// decode_desc: Instruction encoding - (opcode & mask) == match
+//--------------------------------------------------------------------
+struct decode_desc
+{
+    uint32_t mask;
+    uint32_t match;
+    uint16_t inst;
+    uint16_t ext;   // Required extensions (all must be enabled)
+};
+
+//--------------------------------------------------------------------
+// decode_table: Two level RISC-V decode table, built at compile time
+// from an ordered list of encodings (first match wins).
+// Level 1 is keyed on the major opcode [6:0], level 2 on funct3 [14:12].
+// Each leaf holds the ordered encodings which can still match, these
+// are checked against the remaining fields (funct7, rs2, ...).
+//--------------------------------------------------------------------
+#define DECODE_KEY_MASK     0x707F
+#define DECODE_KEYS         (128 * 8)
+
+static inline constexpr int decode_key(uint32_t opcode)
+{
+    return (opcode & 0x7F) | (((opcode >> 12) & 0x7) << 7);
+}
+
+static inline constexpr uint32_t decode_key_bits(int key)
+{
+    return (key & 0x7F) | ((uint32_t)(key >> 7) << 12);
+}
+
+static inline constexpr bool decode_key_match(const decode_desc &d, int key)
+{
+    return ((decode_key_bits(key) ^ d.match) & d.mask & DECODE_KEY_MASK) == 0;
+}
+
+template <int N>
+constexpr int decode_table_size(const decode_desc (&desc)[N])
+{
+    int size = 0;
+    for (int key=0;key<DECODE_KEYS;key++)
+        for (int i=0;i<N;i++)
+            size += decode_key_match(desc[i], key);
+    return size;
+}
+
+template <int SIZE>
+struct decode_table
+{
+    uint16_t    first[DECODE_KEYS + 1];
+    decode_desc leaf[SIZE];
+
+    // Returns instruction index (or no_match)
+    int lookup(uint32_t opcode, int ext, int no_match) const
+    {
+        int key = decode_key(opcode);
+        for (int i=first[key];i<first[key+1];i++)
+            if ((opcode & leaf[i].mask) == leaf[i].match && !(leaf[i].ext & ~ext))
+                return leaf[i].inst;
+        return no_match;
+    }
+};
+
+template <int SIZE, int N>
+constexpr decode_table<SIZE> decode_table_build(const decode_desc (&desc)[N])
+{
+    decode_table<SIZE> t {};
+    int idx = 0;
+    for (int key=0;key<DECODE_KEYS;key++)
+    {
+        t.first[key] = idx;
+        for (int i=0;i<N;i++)
+            if (decode_key_match(desc[i], key))
+                t.leaf[idx++] = desc[i];
+    }
+    t.first[DECODE_KEYS] = idx;
+    return t;
+}
+
+#endif
@@ -10,6 +10,32 @@
 
 #include "memory.h"
 
+//--------------------------------------------------------------------
+// Device scheduling: clock() returns the number of steps until the
+// device next needs to be clocked (0 or 1 = every step).
+// Register accesses and interrupt events re-arm the device so that it
+// is clocked again on the current step.
+//--------------------------------------------------------------------
+#define DEVICE_CLOCK_IDLE   0x7FFFFFFF
+
+struct device_sched
+{
+    uint64_t now;    // Steps elapsed
+    uint64_t next;   // Earliest device deadline
+    uint64_t events; // Deadlines reached (excludes re-armed clocks)
+
+    // Other harts read 'now' and re-arm 'next' (device accesses, posted
+    // requests), so the owning hart writes 'now' and accesses 'next'
+    // atomically. Relaxed ordering - plain moves on the host.
+    uint64_t load_now(void)         { return __atomic_load_n(&now, __ATOMIC_RELAXED); }
+    void     store_now(uint64_t v)  { __atomic_store_n(&now, v, __ATOMIC_RELAXED); }
+    uint64_t load_next(void)        { return __atomic_load_n(&next, __ATOMIC_RELAXED); }
+    void     store_next(uint64_t v) { __atomic_store_n(&next, v, __ATOMIC_RELAXED); }
+
+    // Clock devices on the next step
+    void     rearm(void)            { __atomic_store_n(&next, 0, __ATOMIC_SEQ_CST); }
+};
+
 //--------------------------------------------------------------------
 // Device base class
 //--------------------------------------------------------------------
@@ -23,7 +49,9 @@ public:
         m_irq_number = irq;
         m_irq_raised = false;
         m_irq_dropped= false;
+        m_sched      = NULL;
         device_next  = NULL;
+        clock_deadline = 0;
     }
 
     virtual void set_irq(int irq) { }
@@ -39,7 +67,10 @@ public:
         if (m_irq_ctrl)
             m_irq_ctrl->set_irq(m_irq_number);
         else
+        {
             m_irq_raised = true;
+            clock_rearm();
+        }
     }
 
     virtual void drop_interrupt(void)
@@ -47,7 +78,10 @@ public:
         if (m_irq_ctrl)
             m_irq_ctrl->clr_irq(m_irq_number);
         else
+        {
             m_irq_dropped = true;
+            clock_rearm();
+        }
     }
 
     virtual bool event_irq_raised(void)
@@ -64,6 +98,20 @@ public:
         return val;
     }
 
+    // Scheduling
+    void attach_scheduler(device_sched *sched) { m_sched = sched; }
+
+    uint64_t clock_now(void) { return m_sched ? m_sched->load_now() : 0; }
+
+    void clock_rearm(void)
+    {
+        // Deadlines already due are kept (still counted as an event)
+        if (!m_sched || clock_deadline > m_sched->load_now() + 1)
+            clock_deadline = 0;
+        if (m_sched)
+            m_sched->rearm();
+    }
+
     virtual int  min_access_size(void) { return 4; }
 
     virtual bool write8(uint32_t addr, uint8_t data)
@@ -92,12 +140,14 @@ public:
 
 public:
     device*          device_next;
+    uint64_t         clock_deadline;
 
 protected:
     int              m_irq_number;
     device         * m_irq_ctrl;
     bool             m_irq_raised;
     bool             m_irq_dropped;
+    device_sched   * m_sched;
 };
 
 #endif
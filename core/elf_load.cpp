@@ -11,9 +11,12 @@
 #include <unistd.h>
 #include <libelf.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <gelf.h>
 #include <bfd.h>
 #include <string>
+#include <algorithm>
 
 #include "elf_load.h"
 
@@ -27,6 +30,7 @@ elf_load::elf_load(const char *filename, mem_api *target, bool load_to_paddr /*=
     m_entry_point   = 0;
     m_load_to_paddr = load_to_paddr;
     m_load_offset   = load_offset;
+    m_symbols_loaded= false;
 }
 //--------------------------------------------------------------------
 // load: Load ELF to target
@@ -103,19 +107,12 @@ bool elf_load::load(void)
                 }
 
                 if (shdr64->sh_type == SHT_PROGBITS)
-                {                
-                    int i;
-                    for (i=0;i<shdr64->sh_size;i++)
+                {
+                    if (!m_target->write_block(base_addr, (uint8_t*)data->d_buf, shdr64->sh_size))
                     {
-                        uint32_t load_addr = base_addr + i;
-                        if (m_target->valid_addr(load_addr))
-                            m_target->write(load_addr, ((uint8_t*)data->d_buf)[i]);
-                        else
-                        {
-                            fprintf(stderr, "ERROR: Cannot write byte to 0x%08x\n", load_addr);
-                            close (fd);
-                            return false;
-                        }
+                        fprintf(stderr, "ERROR: Cannot write section to 0x%08x\n", (uint32_t)base_addr);
+                        close (fd);
+                        return false;
                     }
                 }
             }            
@@ -148,19 +145,12 @@ bool elf_load::load(void)
             }
 
             if (shdr->sh_type == SHT_PROGBITS)
-            {                
-                int i;
-                for (i=0;i<shdr->sh_size;i++)
+            {
+                if (!m_target->write_block(base_addr, (uint8_t*)data->d_buf, shdr->sh_size))
                 {
-                    uint32_t load_addr = base_addr + i;
-                    if (m_target->valid_addr(load_addr))
-                        m_target->write(load_addr, ((uint8_t*)data->d_buf)[i]);
-                    else
-                    {
-                        fprintf(stderr, "ERROR: Cannot write byte to 0x%08x\n", load_addr);
-                        close (fd);
-                        return false;
-                    }
+                    fprintf(stderr, "ERROR: Cannot write section to 0x%08x\n", base_addr);
+                    close (fd);
+                    return false;
                 }
             }
         }
@@ -174,9 +164,98 @@ bool elf_load::load(void)
     return true;
 }
 //--------------------------------------------------------------------
-// get_symbol: Get symbol from ELF
+// load_segments: Load PT_LOAD segments from a memory mapped ELF
 //--------------------------------------------------------------------
-bool elf_load::get_symbol(const char *symname, uint32_t &value)
+bool elf_load::load_segments(bool map_text /*= false*/)
+{
+    int fd;
+    struct stat st;
+
+    if (elf_version ( EV_CURRENT ) == EV_NONE)
+        return false;
+
+    if ((fd = open ( m_filename.c_str() , O_RDONLY , 0)) < 0)
+        return false;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close (fd);
+        return false;
+    }
+
+    uint8_t *image = (uint8_t *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (image == (uint8_t *)MAP_FAILED)
+    {
+        close (fd);
+        return false;
+    }
+
+    Elf *e = elf_memory((char *)image, st.st_size);
+    GElf_Ehdr ehdr;
+    size_t    num_phdrs = 0;
+    if (!e || elf_kind(e) != ELF_K_ELF || !gelf_getehdr(e, &ehdr) || elf_getphdrnum(e, &num_phdrs) != 0)
+    {
+        if (e)
+            elf_end(e);
+        munmap(image, st.st_size);
+        close (fd);
+        return false;
+    }
+
+    m_entry_point = (uint32_t)ehdr.e_entry;
+
+    bool ok = true;
+    for (size_t i=0;i<num_phdrs && ok;i++)
+    {
+        GElf_Phdr phdr;
+        if (!gelf_getphdr(e, i, &phdr) || phdr.p_type != PT_LOAD || phdr.p_memsz == 0)
+            continue;
+
+        if (phdr.p_offset + phdr.p_filesz > (uint64_t)st.st_size)
+        {
+            fprintf(stderr, "ERROR: Segment %d exceeds file size\n", (int)i);
+            ok = false;
+            break;
+        }
+
+        uint32_t base_addr = m_load_to_paddr ? phdr.p_paddr : (phdr.p_vaddr + m_load_offset);
+
+        printf("Memory: 0x%x - 0x%x (Size=%dKB) [PT_LOAD %c%c%c]\n", base_addr, (uint32_t)(base_addr + phdr.p_memsz - 1), (int)(phdr.p_memsz / 1024),
+                (phdr.p_flags & PF_R) ? 'R' : '-', (phdr.p_flags & PF_W) ? 'W' : '-', (phdr.p_flags & PF_X) ? 'X' : '-');
+
+        // Read-only segment with no zero fill - use the file pages directly
+        if (map_text && !(phdr.p_flags & PF_W) && phdr.p_filesz == phdr.p_memsz &&
+            m_target->create_memory_file(base_addr, phdr.p_filesz, fd, phdr.p_offset))
+            continue;
+
+        if (!m_target->create_memory(base_addr, phdr.p_memsz))
+        {
+            fprintf(stderr, "ERROR: Cannot allocate memory region\n");
+            ok = false;
+        }
+        else if (phdr.p_filesz && !m_target->write_block(base_addr, image + phdr.p_offset, phdr.p_filesz))
+        {
+            fprintf(stderr, "ERROR: Cannot write segment to 0x%08x\n", base_addr);
+            ok = false;
+        }
+        // Zero fill tail (.bss)
+        else if (phdr.p_memsz > phdr.p_filesz && !m_target->zero_block(base_addr + phdr.p_filesz, phdr.p_memsz - phdr.p_filesz))
+        {
+            fprintf(stderr, "ERROR: Cannot clear segment at 0x%08x\n", (uint32_t)(base_addr + phdr.p_filesz));
+            ok = false;
+        }
+    }
+
+    elf_end ( e );
+    munmap(image, st.st_size);
+    close ( fd );
+
+    return ok;
+}
+//--------------------------------------------------------------------
+// load_symbols: Build symbol index (once per ELF)
+//--------------------------------------------------------------------
+bool elf_load::load_symbols(void)
 {
     bfd *ibfd;
     asymbol **symtab;
@@ -184,6 +263,11 @@ bool elf_load::get_symbol(const char *symname, uint32_t &value)
     symbol_info syminfo;
     char **matching;
 
+    if (m_symbols_loaded)
+        return !m_sym_by_addr.empty() || !m_sym_by_name.empty();
+
+    m_symbols_loaded = true;
+
     bfd_init();
 
     ibfd = bfd_openr(m_filename.c_str(), NULL);
@@ -196,27 +280,85 @@ bool elf_load::get_symbol(const char *symname, uint32_t &value)
     if (!bfd_check_format_matches(ibfd, bfd_object, &matching)) 
     {
         printf("ERROR: get_symbol: format_matches\n");
+        bfd_close(ibfd);
         return false;
     }
  
     nsize  = bfd_get_symtab_upper_bound (ibfd);
+    if (nsize <= 0)
+    {
+        bfd_close(ibfd);
+        return false;
+    }
+
     symtab = (asymbol **)malloc(nsize);
     nsyms  = bfd_canonicalize_symtab(ibfd, symtab);
 
-    bool found = false;
-
     for (i = 0; i < nsyms; i++)
     {
-        if (strcmp(symtab[i]->name, symname) == 0)
-        {
-            bfd_symbol_info(symtab[i], &syminfo);
-            value = syminfo.value;
-            found = true;
-            break;
-        }
+        bfd_symbol_info(symtab[i], &syminfo);
+
+        // First definition wins for name lookups
+        m_sym_by_name.insert(std::make_pair(std::string(symtab[i]->name), (uint64_t)syminfo.value));
+
+        if (symtab[i]->flags & (BSF_SECTION_SYM | BSF_FILE | BSF_DEBUGGING))
+            continue;
+
+        elf_symbol sym;
+        sym.addr = syminfo.value;
+        sym.name = symtab[i]->name;
+        m_sym_by_addr.push_back(sym);
     }
 
-    bfd_close(ibfd);    
+    std::stable_sort(m_sym_by_addr.begin(), m_sym_by_addr.end());
 
-    return found;
+    free(symtab);
+    bfd_close(ibfd);
+
+    return true;
+}
+//--------------------------------------------------------------------
+// get_symbol: Get symbol address by name
+//--------------------------------------------------------------------
+bool elf_load::get_symbol(const char *symname, uint64_t &value)
+{
+    if (!load_symbols())
+        return false;
+
+    std::unordered_map<std::string, uint64_t>::iterator it = m_sym_by_name.find(symname);
+    if (it == m_sym_by_name.end())
+        return false;
+
+    value = it->second;
+    return true;
+}
+bool elf_load::get_symbol(const char *symname, uint32_t &value)
+{
+    uint64_t value64 = 0;
+    if (!get_symbol(symname, value64))
+        return false;
+
+    value = (uint32_t)value64;
+    return true;
+}
+//--------------------------------------------------------------------
+// find_symbol: Find the closest symbol at or below an address
+//--------------------------------------------------------------------
+bool elf_load::find_symbol(uint64_t addr, std::string &name, uint64_t &offset)
+{
+    if (!load_symbols() || m_sym_by_addr.empty())
+        return false;
+
+    elf_symbol key;
+    key.addr = addr;
+
+    // First symbol above addr, then step back one
+    std::vector<elf_symbol>::iterator it = std::upper_bound(m_sym_by_addr.begin(), m_sym_by_addr.end(), key);
+    if (it == m_sym_by_addr.begin())
+        return false;
+    --it;
+
+    name   = it->name;
+    offset = addr - it->addr;
+    return true;
 }
@@ -10,6 +10,8 @@
 
 #include "mem_api.h"
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 //--------------------------------------------------------------------
 // ELF loader
@@ -20,15 +22,35 @@ public:
     elf_load(const char *filename, mem_api *target, bool load_to_paddr = false, int64_t load_offset = 0);
 
     bool     load(void);
+    bool     load_segments(bool map_text = false);
     uint32_t get_entry_point(void) { return m_entry_point; }
     bool     get_symbol(const char *symname, uint32_t &value);
+    bool     get_symbol(const char *symname, uint64_t &value);
+
+    // Nearest symbol at or below addr (offset = addr - symbol)
+    bool     find_symbol(uint64_t addr, std::string &name, uint64_t &offset);
 
 protected:
+    bool     load_symbols(void);
+
+    struct elf_symbol
+    {
+        uint64_t    addr;
+        std::string name;
+
+        bool operator < (const elf_symbol &other) const { return addr < other.addr; }
+    };
+
     std::string m_filename;
     mem_api *   m_target;
     uint32_t    m_entry_point;
     bool        m_load_to_paddr;
     int64_t     m_load_offset;
+
+    // Symbol index (built on first lookup)
+    bool                                      m_symbols_loaded;
+    std::unordered_map<std::string, uint64_t> m_sym_by_name;
+    std::vector<elf_symbol>                   m_sym_by_addr;
 };
 
 #endif
@@ -17,9 +17,44 @@ class mem_api
 {
 public:
     virtual bool    create_memory(uint32_t addr, uint32_t size, uint8_t *mem = NULL) = 0;
+
+    // Create a memory region backed by a private mapping of a file (optional)
+    virtual bool    create_memory_file(uint32_t addr, uint32_t size, int fd, uint64_t offset) { return false; }
     virtual bool    valid_addr(uint32_t addr) = 0;
     virtual void    write(uint32_t addr, uint8_t data) = 0;
     virtual uint8_t read(uint32_t addr) = 0;
+
+    // Bulk access (returns false if any part of the range is not mapped)
+    virtual bool    write_block(uint32_t addr, const uint8_t *data, uint32_t length)
+    {
+        for (uint32_t i=0;i<length;i++)
+        {
+            if (!valid_addr(addr + i))
+                return false;
+            write(addr + i, data[i]);
+        }
+        return true;
+    }
+    virtual bool    zero_block(uint32_t addr, uint32_t length)
+    {
+        for (uint32_t i=0;i<length;i++)
+        {
+            if (!valid_addr(addr + i))
+                return false;
+            write(addr + i, 0);
+        }
+        return true;
+    }
+    virtual bool    read_block(uint32_t addr, uint8_t *data, uint32_t length)
+    {
+        bool res = true;
+        for (uint32_t i=0;i<length;i++)
+        {
+            res &= valid_addr(addr + i);
+            data[i] = read(addr + i);
+        }
+        return res;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -28,6 +28,8 @@ public:
     }
 
     std::string get_name(void)     { return m_name; }
+    uint32_t get_base(void)        { return m_base; }
+    uint32_t get_size(void)        { return m_size; }
     void enable_trace(bool en)     { m_trace = en; }
 
     // Reset / Init
@@ -56,6 +58,13 @@ public:
             res &= write8(addr + i, data >> (8*i));
         return res;
     }
+    virtual bool write64(uint32_t addr, uint64_t data)
+    {
+        bool res = true;
+        res &= write32(addr + 0, data >> 0);
+        res &= write32(addr + 4, data >> 32);
+        return res;
+    }
     virtual bool write_block(uint32_t addr,  uint8_t *data, int length)
     {
         bool res = true;
@@ -65,6 +74,13 @@ public:
             res &= write8(addr + i, *data++);
         return res;
     }
+    virtual bool zero_block(uint32_t addr, uint32_t length)
+    {
+        bool res = true;
+        for (uint32_t i=0;i<length;i++)
+            res &= write8(addr + i, 0);
+        return res;
+    }
 
     // Read Access
     virtual bool read8(uint32_t addr, uint8_t &data) = 0;
@@ -96,6 +112,16 @@ public:
             printf("%s: read32 0x%08x=0x%08x\n", m_name.c_str(), addr, data);        
         return res;
     }
+    virtual bool read64(uint32_t addr, uint64_t &data)
+    {
+        bool res = true;
+        uint32_t lo = 0;
+        uint32_t hi = 0;
+        res &= read32(addr + 0, lo);
+        res &= read32(addr + 4, hi);
+        data = (((uint64_t)hi) << 32) | lo;
+        return res;
+    }
     virtual bool read_block(uint32_t addr,  uint8_t *data, int length)
     {
         bool res = true;
@@ -116,6 +142,9 @@ public:
     // Min access width
     virtual int min_access_size(void) { return 1; }
 
+    // Host memory backing [addr, addr+len) (or NULL if not directly accessible)
+    virtual uint8_t *get_host_ptr(uint32_t addr, uint32_t len) { return NULL; }
+
     // Clock: Clock peripheral (returns next call cycle delta)
     virtual int clock(void) { return 0; }
 
@@ -167,6 +196,101 @@ public:
         return false;
     }
 
+    // Native width accesses (little endian host)
+    bool write16(uint32_t addr, uint32_t data)
+    {
+        uint8_t *p = get_host_ptr(addr, 2);
+        if (!p || m_trace)
+            return memory_base::write16(addr, data);
+
+        uint16_t v = data;
+        memcpy(p, &v, sizeof(v));
+        return true;
+    }
+    bool write32(uint32_t addr, uint32_t data)
+    {
+        uint8_t *p = get_host_ptr(addr, 4);
+        if (!p || m_trace)
+            return memory_base::write32(addr, data);
+
+        memcpy(p, &data, sizeof(data));
+        return true;
+    }
+    bool write64(uint32_t addr, uint64_t data)
+    {
+        uint8_t *p = get_host_ptr(addr, 8);
+        if (!p || m_trace)
+            return memory_base::write64(addr, data);
+
+        memcpy(p, &data, sizeof(data));
+        return true;
+    }
+    bool read16(uint32_t addr, uint16_t &data)
+    {
+        uint8_t *p = get_host_ptr(addr, 2);
+        if (!p || m_trace)
+            return memory_base::read16(addr, data);
+
+        memcpy(&data, p, sizeof(data));
+        return true;
+    }
+    bool read32(uint32_t addr, uint32_t &data)
+    {
+        uint8_t *p = get_host_ptr(addr, 4);
+        if (!p || m_trace)
+            return memory_base::read32(addr, data);
+
+        memcpy(&data, p, sizeof(data));
+        return true;
+    }
+    bool read64(uint32_t addr, uint64_t &data)
+    {
+        uint8_t *p = get_host_ptr(addr, 8);
+        if (!p || m_trace)
+            return memory_base::read64(addr, data);
+
+        memcpy(&data, p, sizeof(data));
+        return true;
+    }
+
+    bool write_block(uint32_t addr, uint8_t *data, int length)
+    {
+        uint8_t *p = get_host_ptr(addr, length);
+        if (!p || m_trace)
+            return memory_base::write_block(addr, data, length);
+
+        memcpy(p, data, length);
+        return true;
+    }
+    bool read_block(uint32_t addr, uint8_t *data, int length)
+    {
+        uint8_t *p = get_host_ptr(addr, length);
+        if (!p || m_trace)
+            return memory_base::read_block(addr, data, length);
+
+        memcpy(data, p, length);
+        return true;
+    }
+
+    bool zero_block(uint32_t addr, uint32_t length)
+    {
+        uint8_t *p = get_host_ptr(addr, length);
+        if (!p || m_trace)
+            return memory_base::zero_block(addr, length);
+
+        memset(p, 0, length);
+        return true;
+    }
+
+    uint8_t *get_host_ptr(uint32_t addr, uint32_t len)
+    {
+        uint32_t offset = addr - m_base;
+        if (offset >= m_size || len > (m_size - offset))
+            return NULL;
+
+        return m_mem + offset;
+    }
+
 protected:
     uint8_t  *m_mem;
 };
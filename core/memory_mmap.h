@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#ifndef __MEMORY_MMAP_H__
+#define __MEMORY_MMAP_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "memory.h"
+
+//-----------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------
+#define MEMORY_MMAP_HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+//-----------------------------------------------------------------
+// memory_mmap: RAM backed by anonymous mmap, allocated on first touch
+//              (or a private copy-on-write mapping of a file)
+//-----------------------------------------------------------------
+class memory_mmap: public memory
+{
+public:
+    memory_mmap(std::string name, uint32_t base, uint32_t size, bool huge_pages = false):
+        memory(name, base, size, map(size, huge_pages))
+    {
+        m_map_size = map_size(size);
+        m_fd       = -1;
+        m_offset   = 0;
+    }
+
+    memory_mmap(std::string name, uint32_t base, uint32_t size, int fd, uint64_t offset):
+        memory(name, base, size, map_file(size, fd, offset))
+    {
+        m_map_size = map_size(size + page_offset(offset));
+        m_fd       = dup(fd);
+        m_offset   = offset;
+    }
+
+    // Dropping the pages returns them to the zero page (or the file
+    // contents for file mappings) - no memset / copy required.
+    virtual void reset(void)
+    {
+        if (m_fd >= 0)
+        {
+            uint8_t *p = m_mem - page_offset(m_offset);
+            if (mmap(p, m_map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                     m_fd, m_offset - page_offset(m_offset)) == MAP_FAILED)
+                reload();
+        }
+        else if (madvise(m_mem, m_map_size, MADV_DONTNEED) != 0)
+            memset(m_mem, 0, m_size);
+    }
+
+    bool zero_block(uint32_t addr, uint32_t length)
+    {
+        uint8_t *p = get_host_ptr(addr, length);
+        if (!p || m_fd >= 0)
+            return memory::zero_block(addr, length);
+
+        // Release whole pages, only clearing the partial pages at each end
+        size_t   page  = sysconf(_SC_PAGESIZE);
+        uint8_t *start = (uint8_t *)(((uintptr_t)p + page - 1) & ~(uintptr_t)(page - 1));
+        uint8_t *end   = (uint8_t *)(((uintptr_t)p + length) & ~(uintptr_t)(page - 1));
+        if (start < end && madvise(start, end - start, MADV_DONTNEED) == 0)
+        {
+            memset(p, 0, start - p);
+            memset(end, 0, (p + length) - end);
+        }
+        else
+            memset(p, 0, length);
+
+        return true;
+    }
+
+private:
+    // Remap failed - copy the file contents back in instead
+    void reload(void)
+    {
+        ssize_t len = pread(m_fd, m_mem, m_size, m_offset);
+        if (len < 0)
+        {
+            fprintf(stderr, "ERROR: Cannot reload file region (%u bytes)\n", m_size);
+            exit(-1);
+        }
+
+        memset(m_mem + len, 0, m_size - len);
+    }
+
+    static size_t page_offset(uint64_t offset)
+    {
+        return offset & (sysconf(_SC_PAGESIZE) - 1);
+    }
+
+    static size_t map_size(uint64_t size)
+    {
+        size_t page = sysconf(_SC_PAGESIZE);
+        return (size + page - 1) & ~(page - 1);
+    }
+
+    static uint8_t *map(uint32_t size, bool huge_pages)
+    {
+        size_t len   = map_size(size);
+        size_t align = huge_pages ? MEMORY_MMAP_HUGE_PAGE_SIZE : 0;
+
+        uint8_t *p = (uint8_t *)mmap(NULL, len + align, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == (uint8_t *)MAP_FAILED)
+        {
+            fprintf(stderr, "ERROR: Cannot map memory region (%u bytes)\n", size);
+            exit(-1);
+        }
+
+        if (huge_pages)
+        {
+            // Trim mapping to a huge page aligned window
+            uint8_t *aligned = (uint8_t *)(((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1));
+            if (aligned != p)
+                munmap(p, aligned - p);
+            if (aligned != p + align)
+                munmap(aligned + len, (p + align) - aligned);
+            p = aligned;
+
+#ifdef MADV_HUGEPAGE
+            madvise(p, len, MADV_HUGEPAGE);
+#endif
+        }
+
+        return p;
+    }
+
+    static uint8_t *map_file(uint32_t size, int fd, uint64_t offset)
+    {
+        size_t delta = page_offset(offset);
+
+        uint8_t *p = (uint8_t *)mmap(NULL, map_size(size + delta), PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE, fd, offset - delta);
+        if (p == (uint8_t *)MAP_FAILED)
+        {
+            fprintf(stderr, "ERROR: Cannot map file region (%u bytes)\n", size);
+            exit(-1);
+        }
+
+        return p + delta;
+    }
+
+    size_t   m_map_size;
+    int      m_fd;
+    uint64_t m_offset;
+};
+
+#endif
@@ -0,0 +1,270 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#include <stdio.h>
+#include <assert.h>
+#include <chrono>
+#include "smp.h"
+
+//-----------------------------------------------------------------
+// Construction
+//-----------------------------------------------------------------
+smp::smp()
+{
+    m_shutdown = false;
+    m_finished = false;
+    m_reason   = RUN_ABORT;
+    m_quantum  = 0;
+}
+//-----------------------------------------------------------------
+// Destruction
+//-----------------------------------------------------------------
+smp::~smp()
+{
+    for (size_t i=0;i<m_harts.size();i++)
+        delete m_harts[i];
+}
+//-----------------------------------------------------------------
+// add_hart: Add hart (stopped harts wait for hart_start)
+//-----------------------------------------------------------------
+void smp::add_hart(cpu *c, bool started)
+{
+    hart *h = new hart;
+    h->c           = c;
+    h->state       = started ? HART_STARTED : HART_STOPPED;
+    h->start_addr  = 0;
+    h->start_arg   = 0;
+    h->start_steps = 0;
+    h->budget      = 0;
+    h->stop        = false;
+    m_harts.push_back(h);
+}
+//-----------------------------------------------------------------
+// hart_start: Start a stopped hart at addr (a0 = hart ID, a1 = arg)
+//-----------------------------------------------------------------
+bool smp::hart_start(int idx, uint32_t addr, uint64_t arg, cpu *caller)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (idx < 0 || idx >= (int)m_harts.size() || m_harts[idx]->state != HART_STOPPED)
+        return false;
+
+    hart *h = m_harts[idx];
+    h->start_addr  = addr;
+    h->start_arg   = arg;
+    h->start_steps = caller ? caller->get_steps() : 0;
+    h->state       = HART_START_PENDING;
+    m_cond.notify_all();
+    return true;
+}
+//-----------------------------------------------------------------
+// hart_stop: Stop a running hart (after its current instruction)
+//-----------------------------------------------------------------
+bool smp::hart_stop(int idx)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (idx < 0 || idx >= (int)m_harts.size() || m_harts[idx]->state != HART_STARTED)
+        return false;
+
+    m_harts[idx]->state = HART_STOP_PENDING;
+    __atomic_store_n(&m_harts[idx]->stop, true, __ATOMIC_RELAXED);
+    return true;
+}
+//-----------------------------------------------------------------
+// hart_status: Get hart state
+//-----------------------------------------------------------------
+hart_state smp::hart_status(int idx)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (idx < 0 || idx >= (int)m_harts.size())
+        return HART_STOPPED;
+
+    return m_harts[idx]->state;
+}
+//-----------------------------------------------------------------
+// hart_thread: Run a hart (and restart it after hart_stop)
+//-----------------------------------------------------------------
+void smp::hart_thread(hart *h, uint64_t max_insts, run_limits limits)
+{
+    limits.abort = &h->stop;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            while (!m_shutdown && h->state == HART_STOPPED)
+                m_cond.wait(lock);
+
+            if (m_shutdown)
+                return ;
+
+            // Started by another hart - keep time in step with it
+            if (h->state == HART_START_PENDING)
+            {
+                h->c->sync_steps(h->start_steps);
+                h->c->boot_hart(h->start_addr, h->start_arg);
+                h->state = HART_STARTED;
+            }
+        }
+
+        run_reason reason = h->c->run(max_insts, limits);
+
+        std::unique_lock<std::mutex> lock(m_lock);
+        if (h->state == HART_STOP_PENDING && !m_shutdown)
+        {
+            h->state = HART_STOPPED;
+            __atomic_store_n(&h->stop, false, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // First hart to finish ends the run
+        if (!m_finished && !m_shutdown)
+        {
+            m_finished = true;
+            m_reason   = reason;
+        }
+
+        h->state = HART_STOPPED;
+        m_cond.notify_all();
+        return ;
+    }
+}
+//-----------------------------------------------------------------
+// run_quantum: Run harts round robin on this thread. Each turn runs
+// a hart up to the end of the current quantum of steps (time skipped
+// by idle / busy-poll loops ends the turn early).
+//-----------------------------------------------------------------
+run_reason smp::run_quantum(uint64_t max_insts, const run_limits &limits)
+{
+    uint64_t horizon = 0;
+
+    for (size_t i=0;i<m_harts.size();i++)
+    {
+        m_harts[i]->budget = max_insts;
+        __atomic_store_n(&m_harts[i]->stop, false, __ATOMIC_RELAXED);
+        if (m_harts[i]->c->get_steps() > horizon)
+            horizon = m_harts[i]->c->get_steps();
+    }
+
+    for (;;)
+    {
+        bool active = false;
+
+        horizon += m_quantum;
+
+        for (size_t i=0;i<m_harts.size();i++)
+        {
+            if (limits.aborted())
+                return RUN_ABORT;
+
+            hart *h = m_harts[i];
+            cpu  *c = h->c;
+
+            // Started by another hart - keep time in step with it
+            if (h->state == HART_START_PENDING)
+            {
+                c->sync_steps(h->start_steps);
+                c->boot_hart(h->start_addr, h->start_arg);
+                h->state = HART_STARTED;
+            }
+            else if (h->state == HART_STOPPED)
+                continue;
+
+            active = true;
+
+            // Already ahead (time skipped past the last horizon)
+            uint64_t now = c->get_steps();
+            if (now >= horizon && h->state == HART_STARTED)
+                continue;
+
+            uint64_t insts   = horizon > now ? (horizon - now) : 1;
+            uint64_t skipped = c->get_skipped_steps();
+            if (insts > h->budget)
+                insts = h->budget;
+
+            run_limits turn = limits;
+            turn.abort = &h->stop;
+            c->set_horizon(horizon, &h->stop);
+            run_reason reason = c->run(insts, turn);
+            c->set_horizon(~(uint64_t)0, NULL);
+
+            // Instructions executed (time less skipped steps)
+            if (h->budget != RUN_FOREVER)
+            {
+                uint64_t done = (c->get_steps() - now) - (c->get_skipped_steps() - skipped);
+                h->budget -= done < h->budget ? done : h->budget;
+                if (h->budget == 0)
+                    return RUN_LIMIT;
+            }
+
+            if (h->state == HART_STOP_PENDING)
+                h->state = HART_STOPPED;
+            else if (reason != RUN_LIMIT && reason != RUN_ABORT)
+                return reason;
+
+            __atomic_store_n(&h->stop, false, __ATOMIC_RELAXED);
+        }
+
+        // Nothing left to run
+        if (!active)
+            return RUN_STOPPED;
+    }
+}
+//-----------------------------------------------------------------
+// run: Run all harts (one thread per hart, or interleaved)
+//-----------------------------------------------------------------
+run_reason smp::run(uint64_t max_insts, const run_limits &limits)
+{
+    assert(!m_harts.empty());
+
+    // Uniprocessor - run on this thread
+    if (m_harts.size() == 1 && m_harts[0]->state == HART_STARTED)
+        return m_harts[0]->c->run(max_insts, limits);
+
+    if (m_quantum)
+        return run_quantum(max_insts, limits);
+
+    m_shutdown = false;
+    m_finished = false;
+    m_reason   = RUN_ABORT;
+
+    // Time is hart 0's step count (see cpu::time_now), which the other
+    // threads cannot skip ahead, so time only advances with instructions
+    // executed: no idle or poll skipping.
+    for (size_t i=0;i<m_harts.size();i++)
+    {
+        m_harts[i]->c->set_bus_lock(&m_bus_lock);
+        m_harts[i]->c->set_horizon(0, NULL);
+        __atomic_store_n(&m_harts[i]->stop, false, __ATOMIC_RELAXED);
+    }
+
+    for (size_t i=0;i<m_harts.size();i++)
+        m_harts[i]->thread = std::thread(&smp::hart_thread, this, m_harts[i], max_insts, limits);
+
+    // Wait for a hart to finish (or a user abort)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        while (!m_finished && !limits.aborted())
+            m_cond.wait_for(lock, std::chrono::milliseconds(10));
+
+        m_shutdown = true;
+        for (size_t i=0;i<m_harts.size();i++)
+            __atomic_store_n(&m_harts[i]->stop, true, __ATOMIC_RELAXED);
+        m_cond.notify_all();
+    }
+
+    for (size_t i=0;i<m_harts.size();i++)
+    {
+        m_harts[i]->thread.join();
+        m_harts[i]->c->set_bus_lock(NULL);
+        m_harts[i]->c->set_horizon(~(uint64_t)0, NULL);
+    }
+
+    return m_finished ? m_reason : RUN_ABORT;
+}
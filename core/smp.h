@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#ifndef __SMP_H__
+#define __SMP_H__
+
+#include <stdint.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include "cpu.h"
+
+//--------------------------------------------------------------------
+// Hart states (as SBI HSM)
+//--------------------------------------------------------------------
+enum hart_state
+{
+    HART_STARTED,
+    HART_STOPPED,
+    HART_START_PENDING,
+    HART_STOP_PENDING
+};
+
+//--------------------------------------------------------------------
+// smp: Harts sharing physical memory, each run on its own host thread
+// or (with a quantum set) interleaved round robin on the calling thread,
+// which is fully deterministic.
+// Hart 0 owns (and clocks) the devices, see cpu::share_memory.
+//--------------------------------------------------------------------
+class smp
+{
+public:
+    smp();
+    ~smp();
+
+    // Harts are numbered in the order added (hart ID)
+    void                add_hart(cpu *c, bool started = true);
+    int                 get_num_harts(void) { return (int)m_harts.size(); }
+    cpu *               get_hart(int idx)   { return m_harts[idx]->c; }
+
+    // Hart state management (from any hart's thread)
+    bool                hart_start(int idx, uint32_t addr, uint64_t arg, cpu *caller);
+    bool                hart_stop(int idx);
+    hart_state          hart_status(int idx);
+
+    // Instructions per turn when interleaving harts (0 = host thread per hart)
+    void                set_quantum(uint64_t insts) { m_quantum = insts; }
+    uint64_t            get_quantum(void)           { return m_quantum; }
+
+    // Run all harts until one stops (or limits.abort is set).
+    // max_insts is the budget of each hart.
+    run_reason          run(uint64_t max_insts, const run_limits &limits);
+
+private:
+    struct hart
+    {
+        cpu            *c;
+        hart_state      state;
+        uint32_t        start_addr;
+        uint64_t        start_arg;
+        uint64_t        start_steps;
+        uint64_t        budget;
+        bool            stop;           // Read by the hart's thread (atomic)
+        std::thread     thread;
+    };
+
+    void                hart_thread(hart *h, uint64_t max_insts, run_limits limits);
+    run_reason          run_quantum(uint64_t max_insts, const run_limits &limits);
+
+    std::vector<hart *> m_harts;
+    std::recursive_mutex m_bus_lock;
+    uint64_t            m_quantum;
+
+    // State changes / completion
+    std::mutex          m_lock;
+    std::condition_variable m_cond;
+    bool                m_shutdown;
+    bool                m_finished;
+    run_reason          m_reason;
+};
+
+#endif
@@ -0,0 +1,215 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#ifndef __TLB_H__
+#define __TLB_H__
+
+#include <stdint.h>
+#include <string.h>
+
+//--------------------------------------------------------------------
+// Defaults
+//--------------------------------------------------------------------
+#define TLB_SETS_DEFAULT    64
+#define TLB_WAYS_DEFAULT    4
+
+//--------------------------------------------------------------------
+// tlb: Set associative TLB tagged with ASID and page size.
+// Superpages are held as a single entry of their own size, lookups
+// return the 4KB (base page) equivalent: physical page | PTE flags.
+// Superpages may also be held as base page entries (split), these
+// remember the PTE level so flushes by address still find them.
+//--------------------------------------------------------------------
+class tlb
+{
+public:
+    tlb(int page_shift, int level_bits, int levels)
+    {
+        m_page_shift = page_shift;
+        m_level_bits = level_bits;
+        m_levels     = levels;
+        m_entries    = NULL;
+        m_victim     = NULL;
+        m_sets       = 0;
+        m_ways       = 0;
+        m_split      = false;
+        hits         = 0;
+        misses       = 0;
+        configure(TLB_SETS_DEFAULT, TLB_WAYS_DEFAULT);
+    }
+
+    ~tlb()
+    {
+        delete [] m_entries;
+        delete [] m_victim;
+    }
+
+    // Resize (sets rounded down to a power of 2), drops all entries
+    void configure(int sets, int ways)
+    {
+        if (sets < 1) sets = 1;
+        if (ways < 1) ways = 1;
+        while (sets & (sets - 1))
+            sets &= sets - 1;
+
+        delete [] m_entries;
+        delete [] m_victim;
+        m_sets    = sets;
+        m_ways    = ways;
+        m_entries = new entry[sets * ways];
+        m_victim  = new uint8_t[sets];
+        flush();
+    }
+
+    // Returns 0 on miss (span: level of the PTE hit)
+    uint64_t lookup(uint64_t va, uint32_t asid, int *span = NULL)
+    {
+        for (int level=0;level<m_levels;level++)
+        {
+            if (!(m_level_used & (1 << level)))
+                continue;
+
+            int      shift = m_page_shift + (level * m_level_bits);
+            uint64_t vpn   = va >> shift;
+            entry   *e     = &m_entries[(vpn & (m_sets-1)) * m_ways];
+            for (int w=0;w<m_ways;w++,e++)
+            {
+                if (e->pte && e->vpn == vpn && e->level == level && (e->global || e->asid == asid))
+                {
+                    hits++;
+                    if (span)
+                        *span = e->span;
+                    return e->pte | (va & ((((uint64_t)1) << shift) - 1) & ~((((uint64_t)1) << m_page_shift) - 1));
+                }
+            }
+        }
+
+        misses++;
+        return 0;
+    }
+
+    // pte: Physical (super)page base | PTE flags
+    // span: Level of the PTE (> level if a superpage is being split)
+    void insert(uint64_t va, int level, uint64_t pte, uint32_t asid, bool global, int span)
+    {
+        int      shift = m_page_shift + (level * m_level_bits);
+        uint64_t vpn   = va >> shift;
+        int      set   = vpn & (m_sets-1);
+        entry   *e     = &m_entries[set * m_ways];
+
+        // Free way, else round robin
+        int way = m_victim[set];
+        for (int w=0;w<m_ways;w++)
+            if (!e[w].pte)
+            {
+                way = w;
+                break;
+            }
+        if (way == m_victim[set])
+            m_victim[set] = (way + 1) % m_ways;
+
+        e += way;
+        e->vpn    = vpn;
+        e->pte    = pte;
+        e->asid   = asid;
+        e->level  = level;
+        e->global = global;
+        e->span   = span;
+        m_level_used |= (1 << level);
+        m_split      |= (span != level);
+    }
+
+    // Drop all entries
+    void flush(void)
+    {
+        memset(m_entries, 0, sizeof(entry) * m_sets * m_ways);
+        memset(m_victim, 0, m_sets);
+        m_level_used = 0;
+        m_split      = false;
+    }
+
+    // Drop entries mapping va (if has_va) belonging to asid (if has_asid).
+    // Global entries are kept when only matching by asid.
+    void flush(uint64_t va, bool has_va, uint32_t asid, bool has_asid)
+    {
+        if (!has_va && !has_asid)
+        {
+            flush();
+            return ;
+        }
+
+        for (int level=0;level<m_levels;level++)
+        {
+            int      shift = m_page_shift + (level * m_level_bits);
+            uint64_t vpn   = va >> shift;
+            int      first = has_va ? (vpn & (m_sets-1)) : 0;
+            int      last  = has_va ? first : (m_sets - 1);
+
+            for (int set=first;set<=last;set++)
+            {
+                entry *e = &m_entries[set * m_ways];
+                for (int w=0;w<m_ways;w++,e++)
+                {
+                    if (!e->pte || e->level != level)
+                        continue;
+                    if (has_va && e->vpn != vpn)
+                        continue;
+                    if (has_asid && (e->global || e->asid != asid))
+                        continue;
+                    e->pte = 0;
+                }
+            }
+        }
+
+        // Split superpages live in the sets of their base pages
+        if (has_va && m_split)
+        {
+            entry *e = m_entries;
+            for (int i=0;i<m_sets*m_ways;i++,e++)
+            {
+                if (!e->pte || e->span == e->level)
+                    continue;
+                int shift = m_page_shift + (e->span * m_level_bits);
+                if ((e->vpn >> (e->span * m_level_bits)) != (va >> shift))
+                    continue;
+                if (has_asid && (e->global || e->asid != asid))
+                    continue;
+                e->pte = 0;
+            }
+        }
+    }
+
+    int get_sets(void) { return m_sets; }
+    int get_ways(void) { return m_ways; }
+
+public:
+    uint64_t hits;
+    uint64_t misses;
+
+private:
+    struct entry
+    {
+        uint64_t vpn;       // Virtual page number (in units of the page size)
+        uint64_t pte;       // Physical page base | flags (0 = invalid)
+        uint32_t asid;
+        uint8_t  level;     // 0 = base page
+        uint8_t  span;      // Level of the PTE (> level when split)
+        bool     global;
+    };
+
+    entry      *m_entries;
+    uint8_t    *m_victim;
+    int         m_sets;
+    int         m_ways;
+    int         m_page_shift;
+    int         m_level_bits;
+    int         m_levels;
+    uint32_t    m_level_used;
+    bool        m_split;        // Any split superpage entries
+};
+
+#endif
@@ -1243,7 +1243,6 @@ int armv6m::armv6m_decode(uint16_t inst)
             case INST_WFI_OPCODE:
             {
                 // Do nothing
-                assert(0);
             }
             break;
             // YIELD - YIELD
@@ -2326,15 +2325,14 @@ void armv6m::armv6m_execute(uint16_t inst, uint16_t inst2)
             // WFE - WFE
             // 1 0 1 1 1 1 1 1 0 0 1 0 0 0 0 0
             case INST_WFE_OPCODE:
-            {
-                // Not implemented
-            }
-            break;
             // WFI - WFI
             // 1 0 1 1 1 1 1 1 0 0 1 1 0 0 0 0
             case INST_WFI_OPCODE:
             {
-                assert(!"Not implemented");
+                // No interrupt pending - skip ahead to the next SysTick / device event
+                // (no other event sources, so WFE sleeps the same way)
+                if (!m_systick_irq)
+                    idle(~(uint64_t)0);
             }
             break;
             // YIELD - YIELD
@@ -25,6 +25,8 @@ public:
     void                reset(uint32_t start_addr);
     uint32_t            get_opcode(uint32_t pc);
     void                step(void);
+    run_reason          run(uint64_t max_insts, const run_limits &limits)
+                        { return run_loop(this, max_insts, limits); }
 
     void                set_interrupt(int irq);
     void                clr_interrupt(int irq) { }
@@ -212,43 +212,43 @@ int mips_i::load(uint32_t pc, uint32_t address, uint32_t *result, int width, boo
     m_stats[STATS_LOADS]++;
     *result = 0;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(physical))
+    memory_base *mem = find_memory(physical);
+    if (mem)
+    {
+        switch (width)
         {
-            switch (width)
-            {
-                case 4:
-                    mem->read32(physical, *result);
-                    break;
-                case 2:
-                {
-                    uint16_t dh = 0;
-                    mem->read16(physical, dh);
-                    *result |= dh;
-
-                    if (signedLoad && ((*result) & (1 << 15)))
-                         *result |= 0xFFFF0000;
-                }
+            case 4:
+                mem->read32(physical, *result);
                 break;
-                case 1:
-                {
-                    uint8_t db = 0;
-                    mem->read8(physical + 0, db);
-                    *result |= ((uint32_t)db << 0);
+            case 2:
+            {
+                uint16_t dh = 0;
+                mem->read16(physical, dh);
+                *result |= dh;
 
-                    if (signedLoad && ((*result) & (1 << 7)))
-                         *result |= 0xFFFFFF00;
-                }
-                break;
-                default:
-                    assert(!"Invalid");
-                    break;
+                if (signedLoad && ((*result) & (1 << 15)))
+                     *result |= 0xFFFF0000;
             }
+            break;
+            case 1:
+            {
+                uint8_t db = 0;
+                mem->read8(physical + 0, db);
+                *result |= ((uint32_t)db << 0);
 
-            DPRINTF(LOG_MEM, ("LOAD_RESULT: 0x%08x\n",*result));
-            return 1;
+                if (signedLoad && ((*result) & (1 << 7)))
+                     *result |= 0xFFFFFF00;
+            }
+            break;
+            default:
+                assert(!"Invalid");
+                break;
         }
 
+        DPRINTF(LOG_MEM, ("LOAD_RESULT: 0x%08x\n",*result));
+        return 1;
+    }
+
     if (m_enable_mem_errors)
     {
         exception(EXC_DBE, pc, address);
@@ -276,67 +276,67 @@ int mips_i::store(uint32_t pc, uint32_t address, uint32_t data, int width, uint8
 
     m_stats[STATS_STORES]++;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(physical))
+    memory_base *mem = find_memory(physical);
+    if (mem)
+    {
+        switch (width)
         {
-            switch (width)
+            case 4:
             {
-                case 4:
+                switch (mask)
                 {
-                    switch (mask)
-                    {
-                        case 0xF:
-                            mem->write32(physical, data);
-                            break;
-                        // SWR/SWL patterns
-                        case 0x7:
-                            mem->write8(physical + 0, data >> 0);
-                            mem->write8(physical + 1, data >> 8);
-                            mem->write8(physical + 2, data >> 16);
-                            break;
-                        case 0xe:
-                            mem->write8(physical + 1, data >> 8);
-                            mem->write8(physical + 2, data >> 16);
-                            mem->write8(physical + 3, data >> 24);
-                            break;
-                        case 0xc:
-                            mem->write8(physical + 2, data >> 16);
-                            mem->write8(physical + 3, data >> 24);
-                            break;
-                        case 0x3:
-                            mem->write8(physical + 0, data >> 0);
-                            mem->write8(physical + 1, data >> 8);
-                            break;
-                        case 0x8:
-                            mem->write8(physical + 3, data >> 24);
-                            break;
-                        case 0x4:
-                            mem->write8(physical + 2, data >> 16);
-                            break;
-                        case 0x2:
-                            mem->write8(physical + 1, data >> 8);
-                            break;
-                        case 0x1:
-                            mem->write8(physical + 0, data >> 0);
-                            break;
-                        default:
-                            assert(!"Invalid");
-                            break;
-                    }
+                    case 0xF:
+                        mem->write32(physical, data);
+                        break;
+                    // SWR/SWL patterns
+                    case 0x7:
+                        mem->write8(physical + 0, data >> 0);
+                        mem->write8(physical + 1, data >> 8);
+                        mem->write8(physical + 2, data >> 16);
+                        break;
+                    case 0xe:
+                        mem->write8(physical + 1, data >> 8);
+                        mem->write8(physical + 2, data >> 16);
+                        mem->write8(physical + 3, data >> 24);
+                        break;
+                    case 0xc:
+                        mem->write8(physical + 2, data >> 16);
+                        mem->write8(physical + 3, data >> 24);
+                        break;
+                    case 0x3:
+                        mem->write8(physical + 0, data >> 0);
+                        mem->write8(physical + 1, data >> 8);
+                        break;
+                    case 0x8:
+                        mem->write8(physical + 3, data >> 24);
+                        break;
+                    case 0x4:
+                        mem->write8(physical + 2, data >> 16);
+                        break;
+                    case 0x2:
+                        mem->write8(physical + 1, data >> 8);
+                        break;
+                    case 0x1:
+                        mem->write8(physical + 0, data >> 0);
+                        break;
+                    default:
+                        assert(!"Invalid");
+                        break;
                 }
+            }
+            break;
+            case 2:
+                mem->write16(physical, data & 0xFFFF);
                 break;
-                case 2:
-                    mem->write16(physical, data & 0xFFFF);
-                    break;
-                case 1:
-                    mem->write8(physical, data & 0xFF);
-                    break;
-                default:
-                    assert(!"Invalid");
-                    break;
-            }        
-            return 1;
-        }
+            case 1:
+                mem->write8(physical, data & 0xFF);
+                break;
+            default:
+                assert(!"Invalid");
+                break;
+        }        
+        return 1;
+    }
 
     if (m_enable_mem_errors)
     {
@@ -29,7 +29,9 @@
 //-----------------------------------------------------------------
 // Constructor
 //-----------------------------------------------------------------
-rv32::rv32(uint32_t baseAddr /*= 0*/, uint32_t len /*= 0*/): cpu()
+rv32::rv32(uint32_t baseAddr /*= 0*/, uint32_t len /*= 0*/): cpu(),
+    m_itlb(MMU_PGSHIFT, MMU_PTIDXBITS, MMU_LEVELS),
+    m_dtlb(MMU_PGSHIFT, MMU_PTIDXBITS, MMU_LEVELS)
 {
     m_enable_unaligned   = false;
     m_enable_mem_errors  = true;
@@ -39,6 +41,13 @@ rv32::rv32(uint32_t baseAddr /*= 0*/, uint32_t len /*= 0*/): cpu()
     m_enable_rva         = true;
     m_enable_mtimecmp    = false;
     m_enable_sbi         = false;
+    m_decode_cache       = NULL;
+    m_block_cache        = NULL;
+    m_block_code         = NULL;
+    m_block_gen          = 1;
+    m_block_exit         = -1;
+
+    enable_decode_cache(true);
 
     // Some memory defined
     if (len != 0)
@@ -68,8 +77,8 @@ void rv32::set_register(int r, uint32_t val)
     else if (r == (RISCV_REGNO_CSR0 + CSR_MTVAL)) m_csr_mtval = val;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MIE)) m_csr_mie = val;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MIP)) m_csr_mip = val;
-    else if (r == (RISCV_REGNO_CSR0 + CSR_MTIME)) m_csr_mtime = val;
-    else if (r == (RISCV_REGNO_CSR0 + CSR_MTIMECMP)) m_csr_mtimecmp = val; // Non-std
+    else if (r == (RISCV_REGNO_CSR0 + CSR_MTIME)) mtime_write(val);
+    else if (r == (RISCV_REGNO_CSR0 + CSR_MTIMECMP)) { m_csr_mtimecmp = val; mtime_update(); } // Non-std
     else if (r == (RISCV_REGNO_CSR0 + CSR_MSCRATCH)) m_csr_mscratch = val;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MIDELEG)) m_csr_mideleg = val;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MEDELEG)) m_csr_medeleg = val;
@@ -81,6 +90,8 @@ void rv32::set_register(int r, uint32_t val)
     else if (r == (RISCV_REGNO_CSR0 + CSR_SSCRATCH)) m_csr_sscratch = val;
     else if (r == RISCV_REGNO_PRIV) m_csr_mpriv = val;
     
+
+    irq_update();
 }
 //-----------------------------------------------------------------
 // get_register: Get register value
@@ -96,8 +107,8 @@ uint32_t rv32::get_register(int r)
     else if (r == (RISCV_REGNO_CSR0 + CSR_MTVAL)) return m_csr_mtval;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MIE)) return m_csr_mie;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MIP)) return m_csr_mip;
-    else if (r == (RISCV_REGNO_CSR0 + CSR_MCYCLE)) return m_csr_mtime;
-    else if (r == (RISCV_REGNO_CSR0 + CSR_MTIME)) return m_csr_mtime;
+    else if (r == (RISCV_REGNO_CSR0 + CSR_MCYCLE)) return mtime();
+    else if (r == (RISCV_REGNO_CSR0 + CSR_MTIME)) return mtime();
     else if (r == (RISCV_REGNO_CSR0 + CSR_MTIMECMP)) return m_csr_mtimecmp; // Non-std
     else if (r == (RISCV_REGNO_CSR0 + CSR_MSCRATCH)) return m_csr_mscratch;
     else if (r == (RISCV_REGNO_CSR0 + CSR_MIDELEG)) return m_csr_mideleg;
@@ -120,6 +131,7 @@ void rv32::reset(uint32_t start_addr)
     m_pc        = start_addr;
     m_pc_x      = start_addr;
     m_load_res  = 0;
+    m_load_val  = 0;
 
     for (int i=0;i<REGISTERS;i++)
         m_gpr[i] = 0;
@@ -132,12 +144,13 @@ void rv32::reset(uint32_t start_addr)
     m_csr_mepc     = 0;
     m_csr_mie      = 0;
     m_csr_mip      = 0;
+    m_irq_pending  = 0;
     m_csr_mcause   = 0;
     m_csr_mevec    = 0;
     m_csr_mtval    = 0;
-    m_csr_mtime    = 0;
     m_csr_mtimecmp = 0;
     m_csr_mtime_ie = false;
+    mtime_write(0);
     m_csr_mscratch = 0;
 
     m_csr_sepc     = 0;
@@ -150,8 +163,11 @@ void rv32::reset(uint32_t start_addr)
     m_fault       = false;
     m_break       = false;
     m_trace       = 0;
+    exec_select();
 
+    m_mmu_level = 0;
     mmu_flush();
+    decode_flush();
 
     stats_reset();
 }
@@ -177,12 +193,19 @@ int rv32::mmu_read_word(uint32_t address, uint32_t *val)
     int m;
     *val = 0;
 
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(address))
-        {
-            mem->read32(address, *val);
-            return 1;
-        }
+    uint8_t *host = find_host_page(address, 4);
+    if (host)
+    {
+        memcpy(val, host, 4);
+        return 1;
+    }
+
+    memory_base *mem = find_memory(address);
+    if (mem)
+    {
+        mem->read32(address, *val);
+        return 1;
+    }
 
     return 0;
 }
@@ -191,21 +214,148 @@ int rv32::mmu_read_word(uint32_t address, uint32_t *val)
 //-----------------------------------------------------------------
 void rv32::mmu_flush(void)
 {
-    for (int i=0;i<MMU_TLB_ENTRIES;i++)
+    // Superblocks are tagged with virtual addresses
+    block_flush();
+
+    m_itlb.flush();
+    m_dtlb.flush();
+    softmmu_flush();
+}
+//-----------------------------------------------------------------
+// mmu_satp_write: Address space switch. TLB entries are tagged with
+// the ASID so are kept, unless the ASID is being reused (software
+// without ASID support relies on this flush).
+//-----------------------------------------------------------------
+void rv32::mmu_satp_write(uint32_t prev)
+{
+    uint32_t asid_prev = (prev >> SATP_ASID_SHIFT) & SATP_ASID_MASK;
+    uint32_t asid      = (m_csr_satp >> SATP_ASID_SHIFT) & SATP_ASID_MASK;
+
+    if (asid == asid_prev)
+    {
+        m_mmu_flush_full++;
+        mmu_flush();
+    }
+    else
+    {
+        block_flush();
+        softmmu_flush();
+    }
+}
+//-----------------------------------------------------------------
+// mmu_sfence: SFENCE.VMA - flush by address and / or ASID
+//-----------------------------------------------------------------
+void rv32::mmu_sfence(uint32_t addr, bool has_addr, uint32_t asid, bool has_asid)
+{
+    if (!has_addr && !has_asid)
+    {
+        m_mmu_flush_full++;
+        mmu_flush();
+        return ;
+    }
+
+    m_mmu_flush_selective++;
+
+    asid &= SATP_ASID_MASK;
+    m_itlb.flush(addr, has_addr, asid, has_asid);
+    m_dtlb.flush(addr, has_addr, asid, has_asid);
+
+    // Superblocks and the softmmu only hold the current address space
+    // (global mappings are not flushed by ASID)
+    if (has_asid && asid != ((m_csr_satp >> SATP_ASID_SHIFT) & SATP_ASID_MASK))
+        return ;
+
+    if (has_addr)
+    {
+        block_flush_page(addr);
+        softmmu_flush_page(addr);
+    }
+    else
+    {
+        block_flush();
+        softmmu_flush();
+    }
+}
+//-----------------------------------------------------------------
+// data_priv: Effective privilege level of data accesses
+//-----------------------------------------------------------------
+inline uint32_t rv32::data_priv(void)
+{
+    // Modify data access privilege level (allows machine mode to use MMU)
+    return (m_csr_msr & SR_MPRV) ? SR_GET_MPP(m_csr_msr) : m_csr_mpriv;
+}
+//-----------------------------------------------------------------
+// softmmu_fill: Cache a successful translation for the virtual page.
+// Entries are keyed by (effective) privilege, so privilege changes
+// need no flush; satp, sfence.vma and SUM / MXR changes flush all.
+//-----------------------------------------------------------------
+void rv32::softmmu_fill(int type, int priv, uint32_t va, uint32_t pa, int level)
+{
+    // Traced accesses always take the slow path
+    if (m_trace)
+        return ;
+
+    softmmu_entry *s = softmmu_lookup(type, priv, va);
+    s->vpn   = va >> SOFTMMU_PAGE_SHIFT;
+    s->level = level;
+    m_softmmu_super |= (level != 0);
+    s->phys  = pa & ~SOFTMMU_PAGE_MASK;
+    s->host  = find_host_page(s->phys, SOFTMMU_PAGE_MASK + 1);
+}
+//-----------------------------------------------------------------
+// softmmu_flush: Drop all cached page translations
+//-----------------------------------------------------------------
+void rv32::softmmu_flush(void)
+{
+    memset(m_softmmu, 0xFF, sizeof(m_softmmu));
+    m_softmmu_super = false;
+}
+//-----------------------------------------------------------------
+// softmmu_flush_page: Drop cached translations for a virtual address
+// (the whole superpage if it was mapped by one)
+//-----------------------------------------------------------------
+void rv32::softmmu_flush_page(uint32_t va)
+{
+    uint32_t vpn = va >> SOFTMMU_PAGE_SHIFT;
+
+    // Base pages only - one slot per privilege / access type
+    if (!m_softmmu_super)
     {
-        m_mmu_addr[i] = 0;
-        m_mmu_pte[i]  = 0;
+        for (int priv=0;priv<4;priv++)
+            for (int type=0;type<SOFTMMU_TYPES;type++)
+            {
+                softmmu_entry *s = softmmu_lookup(type, priv, va);
+                if (s->vpn == vpn)
+                    s->vpn = ~(uint32_t)0;
+            }
+        return ;
+    }
+
+    softmmu_entry *s = &m_softmmu[0][0][0];
+    for (int i=0;i<(int)(sizeof(m_softmmu) / sizeof(m_softmmu[0][0][0]));i++,s++)
+    {
+        if (s->vpn != ~(uint32_t)0 && ((s->vpn ^ vpn) >> (s->level * MMU_PTIDXBITS)) == 0)
+            s->vpn = ~(uint32_t)0;
     }
 }
 //-----------------------------------------------------------------
+// configure_tlb: Set TLB geometry
+//-----------------------------------------------------------------
+void rv32::configure_tlb(int sets, int ways)
+{
+    m_itlb.configure(sets, ways);
+    m_dtlb.configure(sets, ways);
+}
+//-----------------------------------------------------------------
 // mmu_walk: Page table walker
 //-----------------------------------------------------------------
-uint32_t rv32::mmu_walk(uint32_t addr)
+uint32_t rv32::mmu_walk(uint32_t addr, bool ifetch /*= false*/)
 {
     int shift = 32 - MMU_VA_BITS;
     uint32_t pte = 0;
 
     DPRINTF(LOG_MMU, ("MMU: Walk %x\n", addr));
+    m_mmu_level = 0;
 
     // the address must be a canonical sign-extended VA_BITS-bit number    
     if (((int32_t)addr << shift >> shift) != (int32_t)addr)
@@ -221,14 +371,17 @@ uint32_t rv32::mmu_walk(uint32_t addr)
     }
     else
     {
+        tlb &t      = ifetch ? m_itlb : m_dtlb;
+        uint32_t asid = ((m_csr_satp >> SATP_ASID_SHIFT) & SATP_ASID_MASK);
+
         // Fast path lookup in TLBs
-        uint32_t tlb_entry = (addr >> MMU_PGSHIFT) & (MMU_TLB_ENTRIES-1);
-        uint32_t tlb_match = (addr >> MMU_PGSHIFT);
-        if (m_mmu_addr[tlb_entry] == tlb_match && m_mmu_pte[tlb_entry] != 0)
-            return m_mmu_pte[tlb_entry];
+        pte = t.lookup(addr, asid, &m_mmu_level);
+        if (pte)
+            return pte;
 
-        uint32_t base = ((m_csr_satp >> SATP_PPN_SHIFT) & SATP_PPN_MASK) * PAGE_SIZE;
-        uint32_t asid = ((m_csr_satp >> SATP_ASID_SHIFT) & SATP_ASID_MASK);
+        uint32_t base   = ((m_csr_satp >> SATP_PPN_SHIFT) & SATP_PPN_MASK) * PAGE_SIZE;
+        bool global = false;
+        m_mmu_walks++;
 
         DPRINTF(LOG_MMU, ("MMU: MMU enabled - base 0x%08x\n", base));
 
@@ -240,6 +393,7 @@ uint32_t rv32::mmu_walk(uint32_t addr)
             uint32_t pte_addr = base + (idx * MMU_PTESIZE);
 
             // Read PTE
+            m_mmu_pte_reads++;
             if (!mmu_read_word(pte_addr, &pte))
             {
                 DPRINTF(LOG_MMU, ("MMU: Cannot read PTE entry %x\n", pte_addr));
@@ -261,14 +415,18 @@ uint32_t rv32::mmu_walk(uint32_t addr)
             // Next level of page table
             else if (!(pte & (PAGE_READ | PAGE_WRITE | PAGE_EXEC)))
             {
+                global |= (pte & PAGE_GLOBAL) != 0;
                 base = ppn << MMU_PGSHIFT;
                 DPRINTF(LOG_MMU, ("MMU: Next level of page table %x\n", base));
             }
             // The actual PTE
             else
             {
+                global |= (pte & PAGE_GLOBAL) != 0;
+
                 // Keep permission bits
                 pte &= PAGE_FLAGS;
+                m_mmu_level = i;
 
                 // if this PTE is from a larger PT, fake a leaf
                 // PTE so the TLB will work right
@@ -297,8 +455,21 @@ uint32_t rv32::mmu_walk(uint32_t addr)
                     error(false, "%08x: PTE access out of range %x\n", m_pc, addr);
                 }
 
-                m_mmu_addr[tlb_entry] = tlb_match;
-                m_mmu_pte[tlb_entry]  = pte;
+                if (pte)
+                {
+                    // Superpages are cached as a single entry when aligned and
+                    // wholly backed by one memory, else as the 4KB page used
+                    uint64_t     size  = ((uint64_t)1) << (MMU_PGSHIFT + ptshift);
+                    uint64_t     super = ((uint64_t)ppn) << MMU_PGSHIFT;
+                    memory_base *mem   = NULL;
+                    if (i > 0 && (super & (size - 1)) == 0 && (super + size - 1) <= 0xFFFFFFFF)
+                        mem = find_memory(super);
+
+                    if (mem && mem->valid_addr(super + size - 1))
+                        t.insert(addr, i, super | (pte & PAGE_FLAGS), asid, global, i);
+                    else
+                        t.insert(addr, 0, pte, asid, global, i);
+                }
                 break;
             }
         }
@@ -307,9 +478,9 @@ uint32_t rv32::mmu_walk(uint32_t addr)
     return pte;
 }
 //-----------------------------------------------------------------
-// mmu_i_translate: Translate instruction fetch
+// mmu_i_translate: Translate instruction fetch (probe = no trap)
 //-----------------------------------------------------------------
-int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical)
+int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical, bool probe /*= false*/)
 {
     bool page_fault = false;
 
@@ -317,10 +488,11 @@ int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical)
     if (m_csr_mpriv > PRIV_SUPER)
     {
         *physical = addr;
+        softmmu_fill(SOFTMMU_FETCH, m_csr_mpriv, addr, addr, 0);
         return 1; 
     }
     
-    uint32_t pte = mmu_walk(addr);
+    uint32_t pte = mmu_walk(addr, true);
 
     // Reserved configurations
     if (((pte & (PAGE_EXEC | PAGE_READ | PAGE_WRITE)) == PAGE_WRITE) ||
@@ -334,7 +506,8 @@ int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical)
         // Supervisor attempts to execute user mode page
         if (pte & PAGE_USER)
         {
-            error(false, "IMMU: Attempt to execute user page 0x%08x\n", addr);
+            if (!probe)
+                error(false, "IMMU: Attempt to execute user page 0x%08x\n", addr);
             page_fault = true;
         }
         // Page not executable
@@ -356,7 +529,8 @@ int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical)
     if (page_fault)
     {
         *physical      = 0xFFFFFFFF;
-        exception(MCAUSE_PAGE_FAULT_INST, addr, addr);
+        if (!probe)
+            exception(MCAUSE_PAGE_FAULT_INST, addr, addr);
         return 0;
     }
 
@@ -367,6 +541,7 @@ int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical)
     DPRINTF(LOG_MMU, ("IMMU: Lookup VA %x -> PA %x\n", addr, paddr));
 
     *physical = paddr;
+    softmmu_fill(SOFTMMU_FETCH, m_csr_mpriv, addr, paddr, m_mmu_level);
     return 1; 
 }
 //-----------------------------------------------------------------
@@ -375,6 +550,7 @@ int rv32::mmu_i_translate(uint32_t addr, uint32_t *physical)
 int rv32::mmu_d_translate(uint32_t pc, uint32_t addr, uint32_t *physical, int writeNotRead)
 {
     bool page_fault = false;
+    bool cacheable  = true;
     uint32_t priv = m_csr_mpriv;
 
     // Modify data access privilege level (allows machine mode to use MMU)
@@ -385,6 +561,7 @@ int rv32::mmu_d_translate(uint32_t pc, uint32_t addr, uint32_t *physical, int wr
     if (priv > PRIV_SUPER)
     {
         *physical = addr;
+        softmmu_fill(writeNotRead ? SOFTMMU_STORE : SOFTMMU_LOAD, priv, addr, addr, 0);
         return 1; 
     }
 
@@ -407,6 +584,7 @@ int rv32::mmu_d_translate(uint32_t pc, uint32_t addr, uint32_t *physical, int wr
         if ((pte & PAGE_USER) && !(m_csr_msr & SR_SUM))
         {
             error(false, "MMU_D: PC=%08x Access %08x - User page access by super\n", pc, addr);
+            cacheable = false;
         }
         else if ((writeNotRead  && ((pte & (PAGE_WRITE)) != (PAGE_WRITE))) || 
                  (!writeNotRead && ((pte & (PAGE_READ))  != (PAGE_READ))))
@@ -438,17 +616,60 @@ int rv32::mmu_d_translate(uint32_t pc, uint32_t addr, uint32_t *physical, int wr
     DPRINTF(LOG_MMU, ("DMMU: Lookup VA %x -> PA %x\n", addr, paddr));
 
     *physical = paddr;
+    if (cacheable)
+        softmmu_fill(writeNotRead ? SOFTMMU_STORE : SOFTMMU_LOAD, priv, addr, paddr, m_mmu_level);
     return 1; 
 }
 //-----------------------------------------------------------------
+// host_load: Read (and extend) an aligned value from host memory
+//-----------------------------------------------------------------
+static inline uint32_t host_load(const uint8_t *host, int width, bool signedLoad)
+{
+    uint32_t result = 0;
+    switch (width)
+    {
+        case 4:
+            memcpy(&result, host, 4);
+            break;
+        case 2:
+        {
+            int16_t dh;
+            memcpy(&dh, host, 2);
+            result = signedLoad ? (uint32_t)(int32_t)dh : (uint32_t)(uint16_t)dh;
+        }
+        break;
+        case 1:
+            result = signedLoad ? (uint32_t)(int32_t)(int8_t)host[0] : host[0];
+            break;
+        default:
+            assert(!"Invalid");
+            break;
+    }
+    return result;
+}
+//-----------------------------------------------------------------
 // load: Perform a load operation (with optional MMU lookup)
 //-----------------------------------------------------------------
 int rv32::load(uint32_t pc, uint32_t address, uint32_t *result, int width, bool signedLoad)
 {
     uint32_t physical = address;
 
+    // Cached translation for this page (misaligned only within the page)
+    bool       misaligned = (address & (width - 1)) != 0;
+    bool       same_page  = ((address & SOFTMMU_PAGE_MASK) + width) <= (SOFTMMU_PAGE_MASK + 1);
+    softmmu_entry *s = softmmu_lookup(SOFTMMU_LOAD, data_priv(), address);
+    bool       cached = (s->vpn == (address >> SOFTMMU_PAGE_SHIFT)) && (!misaligned || (m_enable_unaligned && same_page));
+    if (cached && s->host)
+    {
+        m_stats[STATS_LOADS]++;
+        *result = host_load(s->host + (address & SOFTMMU_PAGE_MASK), width, signedLoad);
+        return 1;
+    }
+
     // Translate addresses if required
-    if (!mmu_d_translate(pc, address, &physical, 0))
+    if (cached)
+        physical = s->phys | (address & SOFTMMU_PAGE_MASK);
+    else if (!mmu_d_translate(pc, address, &physical, 0))
         return 0;
 
     DPRINTF(LOG_MEM, ("LOAD: VA 0x%08x PA 0x%08x Width %d\n", address, physical, width));
@@ -457,11 +678,21 @@ int rv32::load(uint32_t pc, uint32_t address, uint32_t *result, int width, bool
     *result = 0;
 
     // Detect misaligned load
-    if (((address & 3) != 0 && width == 4) || ((address & 1) != 0 && width == 2))
+    if (misaligned)
     {
         // Support for unaligned loads
         if (m_enable_unaligned)
         {
+            // Within a RAM page - single host access
+            uint8_t *host = same_page ? find_host_page(physical, width) : NULL;
+            if (host)
+            {
+                *result = host_load(host, width, signedLoad);
+                DPRINTF(LOG_MEM, ("LOAD_RESULT: 0x%08x\n",*result));
+                return 1;
+            }
+
+            // Page crossing or MMIO - byte at a time
             int ok = 1;
             for (int j=0;j<width;j++)
             {
@@ -487,44 +718,58 @@ int rv32::load(uint32_t pc, uint32_t address, uint32_t *result, int width, bool
         return 0;
     }
 
-    // Aligned loads
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(physical))
-        {
-            switch (width)
-            {
-                case 4:
-                    mem->read32(physical, *result);
-                    break;
-                case 2:
-                {
-                    uint16_t dh = 0;
-                    mem->read16(physical, dh);
-                    *result |= dh;
+    // Aligned loads (RAM backed - access host memory directly)
+    uint8_t *host = find_host_page(physical, width);
+    if (host)
+    {
+        *result = host_load(host, width, signedLoad);
 
-                    if (signedLoad && ((*result) & (1 << 15)))
-                         *result |= 0xFFFF0000;
-                }
-                break;
-                case 1:
-                {
-                    uint8_t db = 0;
-                    mem->read8(physical + 0, db);
-                    *result |= ((uint32_t)db << 0);
+        DPRINTF(LOG_MEM, ("LOAD_RESULT: 0x%08x\n",*result));
+        return 1;
+    }
 
-                    if (signedLoad && ((*result) & (1 << 7)))
-                         *result |= 0xFFFFFF00;
-                }
+    // Device access (serialised between harts)
+    bus_guard guard(m_bus_lock);
+    memory_base *mem = find_memory(physical);
+    if (mem)
+    {
+        switch (width)
+        {
+            case 4:
+                mem->read32(physical, *result);
                 break;
-                default:
-                    assert(!"Invalid");
-                    break;
+            case 2:
+            {
+                uint16_t dh = 0;
+                mem->read16(physical, dh);
+                *result |= dh;
+
+                if (signedLoad && ((*result) & (1 << 15)))
+                     *result |= 0xFFFF0000;
             }
+            break;
+            case 1:
+            {
+                uint8_t db = 0;
+                mem->read8(physical + 0, db);
+                *result |= ((uint32_t)db << 0);
 
-            DPRINTF(LOG_MEM, ("LOAD_RESULT: 0x%08x\n",*result));
-            return 1;
+                if (signedLoad && ((*result) & (1 << 7)))
+                     *result |= 0xFFFFFF00;
+            }
+            break;
+            default:
+                assert(!"Invalid");
+                break;
         }
 
+        DPRINTF(LOG_MEM, ("LOAD_RESULT: 0x%08x\n",*result));
+
+        // Busy-poll loop on a device register?
+        poll_detect(pc, physical, *result, m_gpr, sizeof(m_gpr));
+        return 1;
+    }
+
     if (m_enable_mem_errors)
     {
         exception(MCAUSE_FAULT_LOAD, pc, address);
@@ -535,25 +780,81 @@ int rv32::load(uint32_t pc, uint32_t address, uint32_t *result, int width, bool
     return 0;
 }
 //-----------------------------------------------------------------
+// read_data: Read an aligned RAM value at a virtual address using the
+// current data translation, without trapping (SBI hosted calls)
+//-----------------------------------------------------------------
+bool rv32::read_data(uint32_t address, uint32_t *value, int width)
+{
+    uint32_t physical = address;
+
+    if (data_priv() <= PRIV_SUPER)
+    {
+        uint32_t pte = mmu_walk(address);
+        if (!(pte & PAGE_PRESENT) || !(pte & PAGE_READ))
+            return false;
+
+        physical = (pte >> MMU_PGSHIFT << MMU_PGSHIFT) | (address & (MMU_PGSIZE-1));
+    }
+
+    uint8_t *host = (address & (width - 1)) ? NULL : find_host_page(physical, width);
+    if (!host)
+        return false;
+
+    *value = host_load(host, width, false);
+    return true;
+}
+//-----------------------------------------------------------------
 // store: Perform a store operation (with optional MMU lookup)
 //-----------------------------------------------------------------
 int rv32::store(uint32_t pc, uint32_t address, uint32_t data, int width)
 {
     uint32_t physical = address;
 
+    poll_break();
+
+    // Cached translation for this page (misaligned only within the page)
+    bool       misaligned = (address & (width - 1)) != 0;
+    bool       same_page  = ((address & SOFTMMU_PAGE_MASK) + width) <= (SOFTMMU_PAGE_MASK + 1);
+    softmmu_entry *s = softmmu_lookup(SOFTMMU_STORE, data_priv(), address);
+    bool       cached = (s->vpn == (address >> SOFTMMU_PAGE_SHIFT)) && (!misaligned || (m_enable_unaligned && same_page));
+    if (cached && s->host)
+    {
+        m_stats[STATS_STORES]++;
+        memcpy(s->host + (address & SOFTMMU_PAGE_MASK), &data, width);
+        physical = s->phys | (address & SOFTMMU_PAGE_MASK);
+        decode_invalidate(physical, width);
+        block_invalidate(physical);
+        resv_store(physical);
+        return 1;
+    }
+
     // Translate addresses if required
-    if (!mmu_d_translate(pc, address, &physical, 1))
+    if (cached)
+        physical = s->phys | (address & SOFTMMU_PAGE_MASK);
+    else if (!mmu_d_translate(pc, address, &physical, 1))
         return 0;
 
     DPRINTF(LOG_MEM, ("STORE: VA 0x%08x PA 0x%08x Value 0x%08x Width %d\n", address, physical, data, width));
     m_stats[STATS_STORES]++;
+    resv_store(physical);
 
     // Detect misaligned store
-    if (((address & 3) != 0 && width == 4) || ((address & 1) != 0 && width == 2))
+    if (misaligned)
     {
         // Support for unaligned stores
         if (m_enable_unaligned)
         {
+            // Within a RAM page - single host access
+            uint8_t *host = same_page ? find_host_page(physical, width) : NULL;
+            if (host)
+            {
+                memcpy(host, &data, width);
+                decode_invalidate(physical, width);
+                block_invalidate(physical);
+                return 1;
+            }
+
+            // Page crossing or MMIO - byte at a time
             int ok = 1;
             for (int j=0;j<width;j++)
             {
@@ -570,27 +871,38 @@ int rv32::store(uint32_t pc, uint32_t address, uint32_t data, int width)
         return 0;
     }    
 
-    // Aligned stores
-    for (memory_base *mem = m_memories; mem != NULL; mem = mem->next)
-        if (mem->valid_addr(physical))
+    // Aligned stores (RAM backed - access host memory directly)
+    uint8_t *host = find_host_page(physical, width);
+    if (host)
+    {
+        memcpy(host, &data, width);
+        decode_invalidate(physical, width);
+        block_invalidate(physical);
+        return 1;
+    }
+
+    // Device access (serialised between harts)
+    bus_guard guard(m_bus_lock);
+    memory_base *mem = find_memory(physical);
+    if (mem)
+    {
+        switch (width)
         {
-            switch (width)
-            {
-                case 4:
-                    mem->write32(physical, data);
-                    break;
-                case 2:
-                    mem->write16(physical, data & 0xFFFF);
-                    break;
-                case 1:
-                    mem->write8(physical, data & 0xFF);
-                    break;
-                default:
-                    assert(!"Invalid");
-                    break;
-            }
-            return 1;
+            case 4:
+                mem->write32(physical, data);
+                break;
+            case 2:
+                mem->write16(physical, data & 0xFFFF);
+                break;
+            case 1:
+                mem->write8(physical, data & 0xFF);
+                break;
+            default:
+                assert(!"Invalid");
+                break;
         }
+        return 1;
+    }
 
     if (m_enable_mem_errors)
     {
@@ -602,12 +914,174 @@ int rv32::store(uint32_t pc, uint32_t address, uint32_t data, int width)
     return 0;
 }
 //-----------------------------------------------------------------
+// amo: Atomic read-modify-write (RAM pages use host atomics)
+//-----------------------------------------------------------------
+int rv32::amo(uint32_t pc, uint32_t address, uint32_t *result, uint32_t src, int op)
+{
+    uint32_t physical = address;
+
+    // Must be naturally aligned
+    if (address & 3)
+    {
+        exception(MCAUSE_MISALIGNED_STORE, pc, address);
+        return 0;
+    }
+
+    // Translate for write (AMOs fault as stores)
+    softmmu_entry *s = softmmu_lookup(SOFTMMU_STORE, data_priv(), address);
+    if (s->vpn == (address >> SOFTMMU_PAGE_SHIFT))
+        physical = s->phys | (address & SOFTMMU_PAGE_MASK);
+    else if (!mmu_d_translate(pc, address, &physical, 1))
+        return 0;
+
+    uint8_t *host = find_host_page(physical, 4);
+
+    // Device register - read then write (serialised between harts)
+    if (!host)
+    {
+        bus_guard guard(m_bus_lock);
+        memory_base *mem = find_memory(physical);
+        if (!mem)
+        {
+            if (m_enable_mem_errors)
+            {
+                exception(MCAUSE_FAULT_STORE, pc, address);
+                return 0;
+            }
+
+            error(false, "%08x: Bad memory access 0x%x\n", pc, address);
+            return 0;
+        }
+
+        poll_break();
+        m_stats[STATS_LOADS]++;
+        m_stats[STATS_STORES]++;
+
+        mem->read32(physical, *result);
+        mem->write32(physical, amo_apply<uint32_t,int32_t>(op, *result, src));
+        resv_store(physical);
+        return 1;
+    }
+
+    poll_break();
+    m_stats[STATS_LOADS]++;
+    m_stats[STATS_STORES]++;
+
+    *result = amo_host<uint32_t,int32_t>((uint32_t*)host, op, src);
+    DPRINTF(LOG_MEM, ("AMO: VA 0x%08x PA 0x%08x Value 0x%08x Result 0x%08x\n", address, physical, src, *result));
+
+    decode_invalidate(physical, 4);
+    block_invalidate(physical);
+    resv_store(physical);
+    return 1;
+}
+//-----------------------------------------------------------------
+// load_reserved: Load and reserve address (LR)
+//-----------------------------------------------------------------
+int rv32::load_reserved(uint32_t pc, uint32_t address, uint32_t *result)
+{
+    // Must be naturally aligned
+    if (address & 3)
+    {
+        exception(MCAUSE_MISALIGNED_LOAD, pc, address);
+        return 0;
+    }
+
+    // Shared memory - reserve the line before reading it
+    if (m_resv)
+    {
+        uint32_t physical;
+        if (!mmu_d_translate(pc, address, &physical, 0))
+            return 0;
+
+        m_resv->reserve(m_hartid, physical);
+    }
+
+    if (!load(pc, address, result, 4, true))
+        return 0;
+
+    m_load_res = address;
+    m_load_val = *result;
+    return 1;
+}
+//-----------------------------------------------------------------
+// store_conditional: Store if reservation is still held (SC),
+// result is 0 on success
+//-----------------------------------------------------------------
+int rv32::store_conditional(uint32_t pc, uint32_t address, uint32_t data, uint32_t *result)
+{
+    bool reserved = (m_load_res == address);
+
+    m_load_res = 0;
+    *result    = 1;
+
+    // Must be naturally aligned
+    if (address & 3)
+    {
+        exception(MCAUSE_MISALIGNED_STORE, pc, address);
+        return 0;
+    }
+
+    if (!reserved)
+        return 1;
+
+    // Single hart
+    if (!m_resv)
+    {
+        if (!store(pc, address, data, 4))
+            return 0;
+
+        *result = 0;
+        return 1;
+    }
+
+    uint32_t physical;
+    if (!mmu_d_translate(pc, address, &physical, 1))
+        return 0;
+
+    // Reservation lost to a store by another hart
+    bool held = m_resv->held(m_hartid, physical);
+    m_resv->clear(m_hartid);
+    if (!held)
+        return 1;
+
+    // RAM - write only if unchanged since the LR (also covers stores the
+    // table cannot see, e.g. device DMA)
+    uint8_t *host = find_host_page(physical, 4);
+    if (host)
+    {
+        uint32_t expected = m_load_val;
+        if (!__atomic_compare_exchange_n((uint32_t*)host, &expected, data, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            return 1;
+
+        poll_break();
+        m_stats[STATS_STORES]++;
+        decode_invalidate(physical, 4);
+        block_invalidate(physical);
+        resv_store(physical);
+        *result = 0;
+        return 1;
+    }
+
+    // Device register
+    bus_guard guard(m_bus_lock);
+    if (!store(pc, address, data, 4))
+        return 0;
+
+    *result = 0;
+    return 1;
+}
+//-----------------------------------------------------------------
 // access_csr: Perform CSR access
 //-----------------------------------------------------------------
 bool rv32::access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint32_t &result)
 {
     result = 0;
 
+    if (set || clr)
+        poll_break();
+
 #define CSR_STD(name, var_name) \
     case CSR_ ##name: \
     { \
@@ -661,9 +1135,8 @@ bool rv32::access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint3
     misa_val |= m_enable_rvc ? MISA_RVC : 0;
     misa_val |= m_enable_rva ? MISA_RVA : 0;
 
-    // SATP write - flush cached TLBs
-    if (((address & 0xFFF) == CSR_SATP) && (set || clr))
-        mmu_flush();
+    uint32_t satp_prev = m_csr_satp;
+    uint32_t msr_prev  = m_csr_msr;
 
     switch (address & 0xFFF)
     {
@@ -744,7 +1217,7 @@ bool rv32::access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint3
         CSR_STD(MIDELEG, m_csr_mideleg)
         CSR_STD(MEDELEG, m_csr_medeleg)
         CSR_STD(MSCRATCH,m_csr_mscratch)
-        CSR_CONST(MHARTID,  MHARTID_VALUE)
+        CSR_CONST(MHARTID,  MHARTID_VALUE + m_hartid)
         //--------------------------------------------------------
         // Standard - Supervisor
         //--------------------------------------------------------
@@ -765,13 +1238,13 @@ bool rv32::access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint3
         CSR_CONST(PMPCFG2, 0)
         CSR_CONST(PMPADDR0, 0)
         case CSR_MTIME:
-            result      = m_csr_mtime;
+            result      = mtime();
             break;
         case CSR_MTIMEH:
-            result      = m_csr_mtime >> 32;
+            result      = mtime() >> 32;
             break;
        case CSR_MCYCLE:
-            result      = m_csr_mtime;
+            result      = mtime();
             break;
 
         // Non-std behaviour
@@ -790,6 +1263,7 @@ bool rv32::access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint3
                 m_csr_mtime_ie = true;
 
             m_enable_mtimecmp = true;
+            mtime_update();
             break;
 
         default:
@@ -797,8 +1271,42 @@ bool rv32::access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint3
             break;
     }
 
-    m_enable_rvc = (misa_val & MISA_RVC) ? true : false;
-    m_enable_rva = (misa_val & MISA_RVA) ? true : false;
+    // Interrupt state changes
+    if (set || clr)
+    {
+        switch (address & 0xFFF)
+        {
+            case CSR_MSTATUS:
+            case CSR_MIP:
+            case CSR_MIE:
+            case CSR_MIDELEG:
+            case CSR_SSTATUS:
+            case CSR_SIP:
+            case CSR_SIE:
+                irq_update();
+                break;
+        }
+    }
+
+    bool enable_rvc = (misa_val & MISA_RVC) ? true : false;
+    bool enable_rva = (misa_val & MISA_RVA) ? true : false;
+
+    // Decoding depends on the enabled extensions
+    if (enable_rvc != m_enable_rvc || enable_rva != m_enable_rva)
+    {
+        m_enable_rvc = enable_rvc;
+        m_enable_rva = enable_rva;
+        decode_flush();
+        exec_select();
+    }
+
+    // SATP write - address space switch
+    if (((address & 0xFFF) == CSR_SATP) && (set || clr))
+        mmu_satp_write(satp_prev);
+
+    // Data access permissions changed - drop cached translations
+    if ((msr_prev ^ m_csr_msr) & (SR_SUM | SR_MXR))
+        softmmu_flush();
 
     return false;
 }
@@ -810,6 +1318,8 @@ void rv32::exception(uint32_t cause, uint32_t pc, uint32_t badaddr /*= 0*/)
     uint32_t deleg;
     uint32_t bit;
 
+    poll_break();
+
     // Interrupt
     if (cause >= MCAUSE_INTERRUPT)
     {
@@ -877,43 +1387,195 @@ void rv32::exception(uint32_t cause, uint32_t pc, uint32_t badaddr /*= 0*/)
         // Set new PC
         m_pc = m_csr_mevec;
     }
+
+    irq_update();
 }
+//-----------------------------------------------------------------
+// decode: Decode opcode into instruction index and operands
+//-----------------------------------------------------------------
+void rv32::decode(uint32_t opcode, decode_entry *d)
+{
+    int ext = (m_enable_rvm ? DECODE_RVM : 0) |
+              (m_enable_rva ? DECODE_RVA : 0) |
+              (m_enable_rvc ? DECODE_RVC : 0);
+
+    d->opcode = opcode;
+    d->inst   = rv32_decode.lookup(opcode, ext, ENUM_INST_MAX);
+
+    d->rd    = (opcode & OPCODE_RD_MASK)  >> OPCODE_RD_SHIFT;
+    d->rs1   = (opcode & OPCODE_RS1_MASK) >> OPCODE_RS1_SHIFT;
+    d->rs2   = (opcode & OPCODE_RS2_MASK) >> OPCODE_RS2_SHIFT;
+    d->shamt = (opcode & OPCODE_SHAMT_MASK) >> OPCODE_SHAMT_SHIFT;
+
+    // Immediate by instruction format (major opcode)
+    switch (opcode & 0x7F)
+    {
+        case 0x37: // LUI
+        case 0x17: // AUIPC
+            d->imm = (int32_t)(opcode & OPCODE_TYPEU_IMM_MASK);
+            break;
+        case 0x6F: // JAL
+            d->imm = OPCODE_UJTYPE_IMM(opcode);
+            break;
+        case 0x63: // Branches
+            d->imm = OPCODE_SBTYPE_IMM(opcode);
+            break;
+        case 0x23: // Stores
+            d->imm = OPCODE_STYPE_IMM(opcode);
+            break;
+        default:
+            d->imm = ((int32_t)opcode) >> OPCODE_TYPEI_IMM_SHIFT;
+            break;
+    }
+}
+//-----------------------------------------------------------------
+// decode_lookup: Find (or fill) pre-decoded instruction at physical
+// address. Returns NULL if the location cannot be cached.
+//-----------------------------------------------------------------
+rv32::decode_entry *rv32::decode_lookup(uint32_t address)
+{
+    if (!m_decode_cache)
+        return NULL;
+
+    uint32_t     tag  = address >> DECODE_PAGE_SHIFT;
+    int          idx  = (address & DECODE_PAGE_MASK) >> 1;
+    decode_page *page = &m_decode_cache[tag & (DECODE_PAGES-1)];
+
+    if (page->tag != tag)
+    {
+        // Only RAM backed pages (stores to these invalidate entries)
+        if (!find_host_page(address & ~DECODE_PAGE_MASK, DECODE_PAGE_MASK + 1))
+            return NULL;
+
+        // Retag page, dropping all previous entries
+        page->tag = tag;
+        if (++page->gen == 0)
+        {
+            for (int i=0;i<DECODE_SLOTS;i++)
+                page->slot[i].gen = 0;
+            page->gen = 1;
+        }
+    }
+
+    decode_entry *d = &page->slot[idx];
+    if (d->gen != page->gen)
+    {
+        // Instructions which may straddle the page end are not cached
+        if (idx == DECODE_SLOTS-1)
+            return NULL;
+
+        decode(get_opcode(address), d);
+        d->gen = page->gen;
+    }
+
+    return d;
+}
+//-----------------------------------------------------------------
+// decode_invalidate: Drop entries overlapping a store
+//-----------------------------------------------------------------
+void rv32::decode_invalidate(uint32_t address, int width)
+{
+    if (!m_decode_cache)
+        return;
+
+    uint32_t     tag  = address >> DECODE_PAGE_SHIFT;
+    decode_page *page = &m_decode_cache[tag & (DECODE_PAGES-1)];
+    if (page->tag == tag)
+    {
+        // Include the previous slot (32-bit opcode at a 16-bit boundary)
+        int first = (address & DECODE_PAGE_MASK) >> 1;
+        int last  = ((address & DECODE_PAGE_MASK) + width - 1) >> 1;
+        for (int i=(first ? first - 1 : 0);i<=last;i++)
+            page->slot[i].gen = 0;
+    }
+}
+//-----------------------------------------------------------------
+// decode_flush: Invalidate pre-decoded instruction cache
+//-----------------------------------------------------------------
+void rv32::decode_flush(void)
+{
+    block_flush();
+
+    if (!m_decode_cache)
+        return;
+
+    for (int i=0;i<DECODE_PAGES;i++)
+        m_decode_cache[i].tag = DECODE_TAG_INVALID;
+}
+//-----------------------------------------------------------------
+// enable_decode_cache: Enable / disable pre-decoded instruction cache
+//-----------------------------------------------------------------
+void rv32::enable_decode_cache(bool en)
+{
+    if (en && !m_decode_cache)
+    {
+        m_decode_cache = new decode_page[DECODE_PAGES];
+        memset(m_decode_cache, 0, sizeof(decode_page) * DECODE_PAGES);
+        decode_flush();
+    }
+    else if (!en && m_decode_cache)
+    {
+        delete [] m_decode_cache;
+        m_decode_cache = NULL;
+    }
+}
+//-----------------------------------------------------------------
+// Execute path: Instantiated per RVC / trace configuration so that the
+// untraced path carries no trace checks. RVM / RVA need no variants as
+// disabled instructions are already rejected at decode.
+//-----------------------------------------------------------------
+#undef DPRINTF
+#undef TRACE_ENABLED
+#define DPRINTF(l,a)        do { if (TRACE_ENABLED(l)) printf a; } while (0)
+#define TRACE_ENABLED(l)    ((CFG & EXEC_TRACE) && (m_trace & l))
+
 //-----------------------------------------------------------------
 // execute: Instruction execution stage
 //-----------------------------------------------------------------
-bool rv32::execute(void)
+template <int CFG>
+bool rv32::execute_cfg(void)
 {
     uint32_t phy_pc = m_pc;
 
-    // Translate PC to physical address
-    if (!mmu_i_translate(m_pc, &phy_pc))
+    // Translate PC to physical address (cached per virtual page)
+    softmmu_entry *s = softmmu_lookup(SOFTMMU_FETCH, m_csr_mpriv, m_pc);
+    if (s->vpn == (m_pc >> SOFTMMU_PAGE_SHIFT))
+        phy_pc = s->phys | (m_pc & SOFTMMU_PAGE_MASK);
+    else if (!mmu_i_translate(m_pc, &phy_pc))
         return false;
 
     // Misaligned PC
-    if ((!m_enable_rvc && (m_pc & 3)) || (m_enable_rvc && (m_pc & 1)))
+    if (m_pc & ((CFG & EXEC_RVC) ? 1 : 3))
     {
         exception(MCAUSE_MISALIGNED_FETCH, m_pc, m_pc);
         return false;
     }
 
-    // Get opcode at current PC
-    uint32_t opcode = get_opcode(phy_pc);
+    // Get (pre-decoded) instruction at current PC
+    decode_entry  fetched;
+    decode_entry *d = decode_lookup(phy_pc);
+    if (!d)
+    {
+        d = &fetched;
+        decode(get_opcode(phy_pc), d);
+    }
+
+    uint32_t opcode = d->opcode;
+    int      inst   = d->inst;
     m_pc_x = m_pc;
 
-    // Extract registers
-    int rd          = (opcode & OPCODE_RD_MASK)  >> OPCODE_RD_SHIFT;
-    int rs1         = (opcode & OPCODE_RS1_MASK) >> OPCODE_RS1_SHIFT;
-    int rs2         = (opcode & OPCODE_RS2_MASK) >> OPCODE_RS2_SHIFT;
-
-    // Extract immediates
-    int typei_imm   = ((signed)(opcode & OPCODE_TYPEI_IMM_MASK)) >> OPCODE_TYPEI_IMM_SHIFT;
-    int typeu_imm   = ((signed)(opcode & OPCODE_TYPEU_IMM_MASK)) >> OPCODE_TYPEU_IMM_SHIFT;
-    int imm20       = typeu_imm << OPCODE_TYPEU_IMM_SHIFT;
-    int imm12       = typei_imm;
-    int bimm        = OPCODE_SBTYPE_IMM(opcode);
-    int jimm20      = OPCODE_UJTYPE_IMM(opcode);
-    int storeimm    = OPCODE_STYPE_IMM(opcode);
-    int shamt       = ((signed)(opcode & OPCODE_SHAMT_MASK)) >> OPCODE_SHAMT_SHIFT;
+    // Registers
+    int rd          = d->rd;
+    int rs1         = d->rs1;
+    int rs2         = d->rs2;
+
+    // Immediates (one per instruction format, extracted at decode)
+    int imm20       = d->imm;
+    int imm12       = d->imm;
+    int bimm        = d->imm;
+    int jimm20      = d->imm;
+    int storeimm    = d->imm;
+    int shamt       = d->shamt;
 
     // Retrieve registers
     uint32_t reg_rd  = 0;
@@ -926,8 +1588,10 @@ bool rv32::execute(void)
     DPRINTF(LOG_OPCODES,( "%08x: %08x\n", pc, opcode));
     DPRINTF(LOG_OPCODES,( "        rd(%d) r%d = %d, r%d = %d\n", rd, rs1, reg_rs1, rs2, reg_rs2));
 
+    switch (inst)
+    {
     // As RVC is not supported, fault on opcode which is all zeros
-    if (opcode == 0)
+    case ENUM_INST_BAD:
     {
         error(false, "Bad instruction @ %x\n", pc);
 
@@ -935,154 +1599,176 @@ bool rv32::execute(void)
         m_fault = true;
         take_exception = true;        
     }
-    else if ((opcode & INST_ANDI_MASK) == INST_ANDI)
+    break;
+    case ENUM_INST_ANDI:
     {
         DPRINTF(LOG_INST,("%08x: andi r%d, r%d, %d\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_ANDI);
         reg_rd = reg_rs1 & imm12;
         pc += 4;
     }
-    else if ((opcode & INST_ORI_MASK) == INST_ORI)
+    break;
+    case ENUM_INST_ORI:
     {
         DPRINTF(LOG_INST,("%08x: ori r%d, r%d, %d\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_ORI);
         reg_rd = reg_rs1 | imm12;
         pc += 4;
     }
-    else if ((opcode & INST_XORI_MASK) == INST_XORI)
+    break;
+    case ENUM_INST_XORI:
     {
         DPRINTF(LOG_INST,("%08x: xori r%d, r%d, %d\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_XORI);
         reg_rd = reg_rs1 ^ imm12;
         pc += 4;
     }
-    else if ((opcode & INST_ADDI_MASK) == INST_ADDI)
+    break;
+    case ENUM_INST_ADDI:
     {
         DPRINTF(LOG_INST,("%08x: addi r%d, r%d, %d\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_ADDI);
         reg_rd = reg_rs1 + imm12;
         pc += 4;
     }
-    else if ((opcode & INST_SLTI_MASK) == INST_SLTI)
+    break;
+    case ENUM_INST_SLTI:
     {
         DPRINTF(LOG_INST,("%08x: slti r%d, r%d, %d\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_SLTI);
         reg_rd = (signed)reg_rs1 < (signed)imm12;
         pc += 4;
     }
-    else if ((opcode & INST_SLTIU_MASK) == INST_SLTIU)
+    break;
+    case ENUM_INST_SLTIU:
     {
         DPRINTF(LOG_INST,("%08x: sltiu r%d, r%d, %d\n", pc, rd, rs1, (unsigned)imm12));
         INST_STAT(ENUM_INST_SLTIU);
         reg_rd = (unsigned)reg_rs1 < (unsigned)imm12;
         pc += 4;
     }
-    else if ((opcode & INST_SLLI_MASK) == INST_SLLI)
+    break;
+    case ENUM_INST_SLLI:
     {
         DPRINTF(LOG_INST,("%08x: slli r%d, r%d, %d\n", pc, rd, rs1, shamt));
         INST_STAT(ENUM_INST_SLLI);
         reg_rd = reg_rs1 << shamt;
         pc += 4;
     }
-    else if ((opcode & INST_SRLI_MASK) == INST_SRLI)
+    break;
+    case ENUM_INST_SRLI:
     {
         DPRINTF(LOG_INST,("%08x: srli r%d, r%d, %d\n", pc, rd, rs1, shamt));
         INST_STAT(ENUM_INST_SRLI);
         reg_rd = (unsigned)reg_rs1 >> shamt;
         pc += 4;
     }
-    else if ((opcode & INST_SRAI_MASK) == INST_SRAI)
+    break;
+    case ENUM_INST_SRAI:
     {
         DPRINTF(LOG_INST,("%08x: srai r%d, r%d, %d\n", pc, rd, rs1, shamt));
         INST_STAT(ENUM_INST_SRAI);
         reg_rd = (signed)reg_rs1 >> shamt;
         pc += 4;
     }
-    else if ((opcode & INST_LUI_MASK) == INST_LUI)
+    break;
+    case ENUM_INST_LUI:
     {
         DPRINTF(LOG_INST,("%08x: lui r%d, 0x%x\n", pc, rd, imm20));
         INST_STAT(ENUM_INST_LUI);
         reg_rd = imm20;
         pc += 4;
     }
-    else if ((opcode & INST_AUIPC_MASK) == INST_AUIPC)
+    break;
+    case ENUM_INST_AUIPC:
     {
         DPRINTF(LOG_INST,("%08x: auipc r%d, 0x%x\n", pc, rd, imm20));
         INST_STAT(ENUM_INST_AUIPC);
         reg_rd = imm20 + pc;
         pc += 4;
     }
-    else if ((opcode & INST_ADD_MASK) == INST_ADD)
+    break;
+    case ENUM_INST_ADD:
     {
         DPRINTF(LOG_INST,("%08x: add r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_ADD);
         reg_rd = reg_rs1 + reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_SUB_MASK) == INST_SUB)
+    break;
+    case ENUM_INST_SUB:
     {
         DPRINTF(LOG_INST,("%08x: sub r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_SUB);
         reg_rd = reg_rs1 - reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_SLT_MASK) == INST_SLT)
+    break;
+    case ENUM_INST_SLT:
     {
         DPRINTF(LOG_INST,("%08x: slt r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_SLT);
         reg_rd = (signed)reg_rs1 < (signed)reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_SLTU_MASK) == INST_SLTU)
+    break;
+    case ENUM_INST_SLTU:
     {
         DPRINTF(LOG_INST,("%08x: sltu r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_SLTU);
         reg_rd = (unsigned)reg_rs1 < (unsigned)reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_XOR_MASK) == INST_XOR)
+    break;
+    case ENUM_INST_XOR:
     {
         DPRINTF(LOG_INST,("%08x: xor r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_XOR);
         reg_rd = reg_rs1 ^ reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_OR_MASK) == INST_OR)
+    break;
+    case ENUM_INST_OR:
     {
         DPRINTF(LOG_INST,("%08x: or r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_OR);
         reg_rd = reg_rs1 | reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_AND_MASK) == INST_AND)
+    break;
+    case ENUM_INST_AND:
     {
         DPRINTF(LOG_INST,("%08x: and r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_AND);
         reg_rd = reg_rs1 & reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_SLL_MASK) == INST_SLL)
+    break;
+    case ENUM_INST_SLL:
     {
         DPRINTF(LOG_INST,("%08x: sll r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_SLL);
         reg_rd = reg_rs1 << reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_SRL_MASK) == INST_SRL)
+    break;
+    case ENUM_INST_SRL:
     {
         DPRINTF(LOG_INST,("%08x: srl r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_SRL);
         reg_rd = (unsigned)reg_rs1 >> reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_SRA_MASK) == INST_SRA)
+    break;
+    case ENUM_INST_SRA:
     {
         DPRINTF(LOG_INST,("%08x: sra r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_SRA);
         reg_rd = (signed)reg_rs1 >> reg_rs2;
         pc += 4;
     }
-    else if ((opcode & INST_JAL_MASK) == INST_JAL)
+    break;
+    case ENUM_INST_JAL:
     {
         DPRINTF(LOG_INST,("%08x: jal r%d, %d\n", pc, rd, jimm20));
         INST_STAT(ENUM_INST_JAL);
@@ -1096,7 +1782,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;
     }
-    else if ((opcode & INST_JALR_MASK) == INST_JALR)
+    break;
+    case ENUM_INST_JALR:
     {
         DPRINTF(LOG_INST,("%08x: jalr r%d, r%d\n", pc, rs1, imm12));
         INST_STAT(ENUM_INST_JALR);
@@ -1112,7 +1799,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_BEQ_MASK) == INST_BEQ)
+    break;
+    case ENUM_INST_BEQ:
     {
         DPRINTF(LOG_INST,("%08x: beq r%d, r%d, %d\n", pc, rs1, rs2, bimm));
         INST_STAT(ENUM_INST_BEQ);
@@ -1130,7 +1818,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_BNE_MASK) == INST_BNE)
+    break;
+    case ENUM_INST_BNE:
     {
         DPRINTF(LOG_INST,("%08x: bne r%d, r%d, %d\n", pc, rs1, rs2, bimm));
         INST_STAT(ENUM_INST_BNE);
@@ -1148,7 +1837,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_BLT_MASK) == INST_BLT)
+    break;
+    case ENUM_INST_BLT:
     {
         DPRINTF(LOG_INST,("%08x: blt r%d, r%d, %d\n", pc, rs1, rs2, bimm));
         INST_STAT(ENUM_INST_BLT);
@@ -1166,7 +1856,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_BGE_MASK) == INST_BGE)
+    break;
+    case ENUM_INST_BGE:
     {
         DPRINTF(LOG_INST,("%08x: bge r%d, r%d, %d\n", pc, rs1, rs2, bimm));
         INST_STAT(ENUM_INST_BGE);
@@ -1184,7 +1875,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_BLTU_MASK) == INST_BLTU)
+    break;
+    case ENUM_INST_BLTU:
     {
         DPRINTF(LOG_INST,("%08x: bltu r%d, r%d, %d\n", pc, rs1, rs2, bimm));
         INST_STAT(ENUM_INST_BLTU);
@@ -1202,7 +1894,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_BGEU_MASK) == INST_BGEU)
+    break;
+    case ENUM_INST_BGEU:
     {
         DPRINTF(LOG_INST,("%08x: bgeu r%d, r%d, %d\n", pc, rs1, rs2, bimm));
         INST_STAT(ENUM_INST_BGEU);
@@ -1220,7 +1913,8 @@ bool rv32::execute(void)
 
         m_stats[STATS_BRANCHES]++;        
     }
-    else if ((opcode & INST_LB_MASK) == INST_LB)
+    break;
+    case ENUM_INST_LB:
     {
         DPRINTF(LOG_INST,("%08x: lb r%d, %d(r%d)\n", pc, rd, imm12, rs1));
         INST_STAT(ENUM_INST_LB);
@@ -1229,7 +1923,8 @@ bool rv32::execute(void)
         else
             return false;
     }
-    else if ((opcode & INST_LH_MASK) == INST_LH)
+    break;
+    case ENUM_INST_LH:
     {
         DPRINTF(LOG_INST,("%08x: lh r%d, %d(r%d)\n", pc, rd, imm12, rs1));
         INST_STAT(ENUM_INST_LH);
@@ -1238,7 +1933,8 @@ bool rv32::execute(void)
         else
             return false;
     }
-    else if ((opcode & INST_LW_MASK) == INST_LW)
+    break;
+    case ENUM_INST_LW:
     {
         INST_STAT(ENUM_INST_LW);
         DPRINTF(LOG_INST,("%08x: lw r%d, %d(r%d)\n", pc, rd, imm12, rs1));
@@ -1247,7 +1943,8 @@ bool rv32::execute(void)
         else
             return false;
     }
-    else if ((opcode & INST_LBU_MASK) == INST_LBU)
+    break;
+    case ENUM_INST_LBU:
     {
         DPRINTF(LOG_INST,("%08x: lbu r%d, %d(r%d)\n", pc, rd, imm12, rs1));
         INST_STAT(ENUM_INST_LBU);
@@ -1256,7 +1953,8 @@ bool rv32::execute(void)
         else
             return false;
     }
-    else if ((opcode & INST_LHU_MASK) == INST_LHU)
+    break;
+    case ENUM_INST_LHU:
     {
         DPRINTF(LOG_INST,("%08x: lhu r%d, %d(r%d)\n", pc, rd, imm12, rs1));
         INST_STAT(ENUM_INST_LHU);
@@ -1265,7 +1963,8 @@ bool rv32::execute(void)
         else
             return false;
     }
-    else if ((opcode & INST_LWU_MASK) == INST_LWU)
+    break;
+    case ENUM_INST_LWU:
     {
         DPRINTF(LOG_INST,("%08x: lwu r%d, %d(r%d)\n", pc, rd, imm12, rs1));
         INST_STAT(ENUM_INST_LWU);
@@ -1274,7 +1973,8 @@ bool rv32::execute(void)
         else
             return false;
     }
-    else if ((opcode & INST_SB_MASK) == INST_SB)
+    break;
+    case ENUM_INST_SB:
     {
         DPRINTF(LOG_INST,("%08x: sb %d(r%d), r%d\n", pc, storeimm, rs1, rs2));
         INST_STAT(ENUM_INST_SB);
@@ -1286,7 +1986,8 @@ bool rv32::execute(void)
         // No writeback
         rd = 0;
     }
-    else if ((opcode & INST_SH_MASK) == INST_SH)
+    break;
+    case ENUM_INST_SH:
     {
         DPRINTF(LOG_INST,("%08x: sh %d(r%d), r%d\n", pc, storeimm, rs1, rs2));
         INST_STAT(ENUM_INST_SH);
@@ -1298,7 +1999,8 @@ bool rv32::execute(void)
         // No writeback
         rd = 0;
     }
-    else if ((opcode & INST_SW_MASK) == INST_SW)
+    break;
+    case ENUM_INST_SW:
     {
         DPRINTF(LOG_INST,("%08x: sw %d(r%d), r%d\n", pc, storeimm, rs1, rs2));
         INST_STAT(ENUM_INST_SW);
@@ -1310,7 +2012,8 @@ bool rv32::execute(void)
         // No writeback
         rd = 0;
     }
-    else if (m_enable_rvm && (opcode & INST_MUL_MASK) == INST_MUL)
+    break;
+    case ENUM_INST_MUL:
     {
         DPRINTF(LOG_INST,("%08x: mul r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_MUL);
@@ -1318,7 +2021,8 @@ bool rv32::execute(void)
         reg_rd = (signed)reg_rs1 * (signed)reg_rs2;
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_MULH_MASK) == INST_MULH)
+    break;
+    case ENUM_INST_MULH:
     {
         long long res = ((long long) (int)reg_rs1) * ((long long)(int)reg_rs2);
         INST_STAT(ENUM_INST_MULH);
@@ -1327,7 +2031,8 @@ bool rv32::execute(void)
         reg_rd = (int)(res >> 32);
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_MULHSU_MASK) == INST_MULHSU)
+    break;
+    case ENUM_INST_MULHSU:
     {
         long long res = ((long long) (int)reg_rs1) * ((unsigned long long)(unsigned)reg_rs2);
         INST_STAT(ENUM_INST_MULHSU);
@@ -1336,7 +2041,8 @@ bool rv32::execute(void)
         reg_rd = (int)(res >> 32);
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_MULHU_MASK) == INST_MULHU)
+    break;
+    case ENUM_INST_MULHU:
     {
         unsigned long long res = ((unsigned long long) (unsigned)reg_rs1) * ((unsigned long long)(unsigned)reg_rs2);
         INST_STAT(ENUM_INST_MULHU);
@@ -1345,7 +2051,8 @@ bool rv32::execute(void)
         reg_rd = (int)(res >> 32);
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_DIV_MASK) == INST_DIV)
+    break;
+    case ENUM_INST_DIV:
     {
         DPRINTF(LOG_INST,("%08x: div r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_DIV);
@@ -1358,7 +2065,8 @@ bool rv32::execute(void)
             reg_rd = (unsigned)-1;
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_DIVU_MASK) == INST_DIVU)
+    break;
+    case ENUM_INST_DIVU:
     {
         DPRINTF(LOG_INST,("%08x: divu r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_DIVU);
@@ -1369,7 +2077,8 @@ bool rv32::execute(void)
             reg_rd = (unsigned)-1;
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_REM_MASK) == INST_REM)
+    break;
+    case ENUM_INST_REM:
     {
         DPRINTF(LOG_INST,("%08x: rem r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_REM);
@@ -1383,7 +2092,8 @@ bool rv32::execute(void)
             reg_rd = reg_rs1;
         pc += 4;
     }
-    else if (m_enable_rvm && (opcode & INST_REMU_MASK) == INST_REMU)
+    break;
+    case ENUM_INST_REMU:
     {
         DPRINTF(LOG_INST,("%08x: remu r%d, r%d, r%d\n", pc, rd, rs1, rs2));
         INST_STAT(ENUM_INST_REMU);
@@ -1394,7 +2104,8 @@ bool rv32::execute(void)
             reg_rd = reg_rs1;
         pc += 4;
     }
-    else if ((opcode & INST_ECALL_MASK) == INST_ECALL)
+    break;
+    case ENUM_INST_ECALL:
     {
         DPRINTF(LOG_INST,("%08x: ecall\n", pc));
         INST_STAT(ENUM_INST_ECALL);
@@ -1408,7 +2119,8 @@ bool rv32::execute(void)
             take_exception   = true;
         }
     }
-    else if ((opcode & INST_EBREAK_MASK) == INST_EBREAK)
+    break;
+    case ENUM_INST_EBREAK:
     {
         DPRINTF(LOG_INST,("%08x: ebreak\n", pc));
         INST_STAT(ENUM_INST_EBREAK);
@@ -1417,7 +2129,8 @@ bool rv32::execute(void)
         take_exception   = true;
         m_break          = true;
     }
-    else if ((opcode & INST_MRET_MASK) == INST_MRET)
+    break;
+    case ENUM_INST_MRET:
     {
         DPRINTF(LOG_INST,("%08x: mret\n", pc));
         INST_STAT(ENUM_INST_MRET);
@@ -1439,11 +2152,13 @@ bool rv32::execute(void)
         // Set privilege level to previous MPP
         m_csr_mpriv   = prev_prv;
         m_csr_msr     = s;
+        irq_update();
 
         // Return to EPC
         pc = m_csr_mepc;
     }
-    else if ((opcode & INST_SRET_MASK) == INST_SRET)
+    break;
+    case ENUM_INST_SRET:
     {
         DPRINTF(LOG_INST,("%08x: sret\n", pc));
         INST_STAT(ENUM_INST_SRET);
@@ -1464,23 +2179,30 @@ bool rv32::execute(void)
         // Set privilege level to previous MPP
         m_csr_mpriv   = prev_prv;
         m_csr_msr     = s;
+        irq_update();
 
         // Return to EPC
         pc = m_csr_sepc;
     }
-    else if ( ((opcode & INST_SFENCE_MASK) == INST_SFENCE) ||
-              ((opcode & INST_FENCE_MASK) == INST_FENCE) ||
-              ((opcode & INST_IFENCE_MASK) == INST_IFENCE))
+    break;
+    case ENUM_INST_FENCE:
     {
         DPRINTF(LOG_INST,("%08x: fence\n", pc));
         INST_STAT(ENUM_INST_FENCE);
 
-        // SFENCE.VMA
+        // SFENCE.VMA (rs1 = address, rs2 = ASID, x0 = all)
         if ((opcode & INST_SFENCE_MASK) == INST_SFENCE)
-            mmu_flush();
+            mmu_sfence(reg_rs1, rs1 != 0, reg_rs2, rs2 != 0);
+        // FENCE.I
+        else if ((opcode & INST_IFENCE_MASK) == INST_IFENCE)
+        {
+            m_mmu_fence_i++;
+            decode_flush();
+        }
         pc += 4;
     }
-    else if ((opcode & INST_CSRRW_MASK) == INST_CSRRW)
+    break;
+    case ENUM_INST_CSRRW:
     {
         DPRINTF(LOG_INST,("%08x: csrw r%d, r%d, 0x%x\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_CSRRW);
@@ -1489,8 +2211,9 @@ bool rv32::execute(void)
             exception(MCAUSE_ILLEGAL_INSTRUCTION, pc, opcode);
         else
             pc += 4;
-    }    
-    else if ((opcode & INST_CSRRS_MASK) == INST_CSRRS)
+    }
+    break;
+    case ENUM_INST_CSRRS:
     {
         DPRINTF(LOG_INST,("%08x: csrs r%d, r%d, 0x%x\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_CSRRS);
@@ -1500,7 +2223,8 @@ bool rv32::execute(void)
         else
             pc += 4;
     }
-    else if ((opcode & INST_CSRRC_MASK) == INST_CSRRC)
+    break;
+    case ENUM_INST_CSRRC:
     {
         DPRINTF(LOG_INST,("%08x: csrc r%d, r%d, 0x%x\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_CSRRC);
@@ -1510,7 +2234,8 @@ bool rv32::execute(void)
         else
             pc += 4;
     }
-    else if ((opcode & INST_CSRRWI_MASK) == INST_CSRRWI)
+    break;
+    case ENUM_INST_CSRRWI:
     {
         DPRINTF(LOG_INST,("%08x: csrwi r%d, %d, 0x%x\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_CSRRWI);
@@ -1520,7 +2245,8 @@ bool rv32::execute(void)
         else
             pc += 4;
     }
-    else if ((opcode & INST_CSRRSI_MASK) == INST_CSRRSI)
+    break;
+    case ENUM_INST_CSRRSI:
     {
         DPRINTF(LOG_INST,("%08x: csrsi r%d, %d, 0x%x\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_CSRRSI);
@@ -1530,7 +2256,8 @@ bool rv32::execute(void)
         else
             pc += 4;
     }
-    else if ((opcode & INST_CSRRCI_MASK) == INST_CSRRCI)
+    break;
+    case ENUM_INST_CSRRCI:
     {
         DPRINTF(LOG_INST,("%08x: csrci r%d, %d, 0x%x\n", pc, rd, rs1, imm12));
         INST_STAT(ENUM_INST_CSRRCI);
@@ -1540,28 +2267,27 @@ bool rv32::execute(void)
         else
             pc += 4;
     }
-    else if ((opcode & INST_WFI_MASK) == INST_WFI)
+    break;
+    case ENUM_INST_WFI:
     {
         DPRINTF(LOG_INST,("%08x: wfi\n", pc));
         INST_STAT(ENUM_INST_WFI);
+
+        // Nothing pending - skip ahead to the next timer / device event
+        if (!(m_csr_mip & m_csr_mie))
+            idle(timer_event());
         pc += 4;
     }
+    break;
     //-----------------------------------------------------------------
     // A Extension
     //-----------------------------------------------------------------
-    else if (m_enable_rva && (opcode & INST_AMOADD_W_MASK) == INST_AMOADD_W)
+    case ENUM_INST_AMOADD_W:
     {
         DPRINTF(LOG_INST,("%08x: amoadd.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rd + reg_rs2;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_ADD))
             return false;
 
         INST_STAT(ENUM_INST_ADD);
@@ -1569,19 +2295,13 @@ bool rv32::execute(void)
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOXOR_W_MASK) == INST_AMOXOR_W)
+    break;
+    case ENUM_INST_AMOXOR_W:
     {
         DPRINTF(LOG_INST,("%08x: amoxor.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rd ^ reg_rs2;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_XOR))
             return false;
 
         INST_STAT(ENUM_INST_XOR);
@@ -1589,19 +2309,13 @@ bool rv32::execute(void)
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOOR_W_MASK) == INST_AMOOR_W)
+    break;
+    case ENUM_INST_AMOOR_W:
     {
         DPRINTF(LOG_INST,("%08x: amoor.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rd | reg_rs2;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_OR))
             return false;
 
         INST_STAT(ENUM_INST_OR);
@@ -1609,19 +2323,13 @@ bool rv32::execute(void)
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOAND_W_MASK) == INST_AMOAND_W)
+    break;
+    case ENUM_INST_AMOAND_W:
     {
         DPRINTF(LOG_INST,("%08x: amoand.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rd & reg_rs2;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_AND))
             return false;
 
         INST_STAT(ENUM_INST_AND);
@@ -1629,141 +2337,97 @@ bool rv32::execute(void)
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOMIN_W_MASK) == INST_AMOMIN_W)
+    break;
+    case ENUM_INST_AMOMIN_W:
     {
         DPRINTF(LOG_INST,("%08x: amomin.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rs2;
-        if ((int32_t)reg_rd < (int32_t)reg_rs2)
-            val = reg_rd;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_MIN))
             return false;
 
         INST_STAT(ENUM_INST_LW);
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOMAX_W_MASK) == INST_AMOMAX_W)
+    break;
+    case ENUM_INST_AMOMAX_W:
     {
         DPRINTF(LOG_INST,("%08x: amomax.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rs2;
-        if ((int32_t)reg_rd > (int32_t)reg_rs2)
-            val = reg_rd;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_MAX))
             return false;
 
         INST_STAT(ENUM_INST_LW);
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOMINU_W_MASK) == INST_AMOMINU_W)
+    break;
+    case ENUM_INST_AMOMINU_W:
     {
         DPRINTF(LOG_INST,("%08x: amominu.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rs2;
-        if ((uint32_t)reg_rd < (uint32_t)reg_rs2)
-            val = reg_rd;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_MINU))
             return false;
 
         INST_STAT(ENUM_INST_LW);
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOMAXU_W_MASK) == INST_AMOMAXU_W)
+    break;
+    case ENUM_INST_AMOMAXU_W:
     {
         DPRINTF(LOG_INST,("%08x: amomaxu.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Modify
-        uint32_t val = reg_rs2;
-        if ((uint32_t)reg_rd > (uint32_t)reg_rs2)
-            val = reg_rd;
-
-        // Write
-        if (!store(pc, reg_rs1, val, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_MAXU))
             return false;
 
         INST_STAT(ENUM_INST_LW);
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_AMOSWAP_W_MASK) == INST_AMOSWAP_W)
+    break;
+    case ENUM_INST_AMOSWAP_W:
     {
         DPRINTF(LOG_INST,("%08x: amoswap.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
 
-        // Read
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
-            return false;
-
-        // Write
-        if (!store(pc, reg_rs1, reg_rs2, 4))
+        // Read, modify, write (atomic with respect to other harts)
+        if (!amo(pc, reg_rs1, &reg_rd, reg_rs2, AMO_SWAP))
             return false;
 
         INST_STAT(ENUM_INST_LW);
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_LR_W_MASK) == INST_LR_W)
+    break;
+    case ENUM_INST_LR_W:
     {
         DPRINTF(LOG_INST,("%08x: lr.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
-        if (!load(pc, reg_rs1, &reg_rd, 4, true))
+        if (!load_reserved(pc, reg_rs1, &reg_rd))
             return false;
 
-        // Record load address
-        m_load_res = reg_rs1;
-
         INST_STAT(ENUM_INST_LW);
         pc += 4;
     }
-    else if (m_enable_rva && (opcode & INST_SC_W_MASK) == INST_SC_W)
+    break;
+    case ENUM_INST_SC_W:
     {
         DPRINTF(LOG_INST,("%08x: sc.w r%d, r%d, r%d\n", pc, rd, rs1, rs2));
-        if (m_load_res == reg_rs1)
-        {
-            // Write
-            if (!store(pc, reg_rs1, reg_rs2, 4))
-                return false;
-
-            reg_rd = 0;
-        }
-        else
-            reg_rd = 1;
+        if (!store_conditional(pc, reg_rs1, reg_rs2, &reg_rd))
+            return false;
 
-        m_load_res = 0;
         INST_STAT(ENUM_INST_SW);
         pc += 4;
     }
+    break;
     //-----------------------------------------------------------------
     // C Extension
     //-----------------------------------------------------------------
     // RVC - Quadrant 0
-    else if (m_enable_rvc && ((opcode & 3) == 0))
+    case ENUM_INST_RVC_Q0:
     {
         opcode &= 0xFFFF;
         rvc_decode rvc(opcode);
@@ -1836,8 +2500,9 @@ bool rv32::execute(void)
             take_exception = true;
         }
     }
+    break;
     // RVC - Quadrant 1 (top half - c.nop - c.lui)
-    else if (m_enable_rvc && ((opcode & 3) == 1) && (((opcode & 0xFFFF) >> 13) < 4))
+    case ENUM_INST_RVC_Q1_LO:
     {
         opcode &= 0xFFFF;
         rvc_decode rvc(opcode);
@@ -1915,8 +2580,9 @@ bool rv32::execute(void)
             take_exception = true;
         }
     }
+    break;
     // RVC - Quadrant 1 (bottom half - c.srli -)
-    else if (m_enable_rvc && ((opcode & 3) == 1))
+    case ENUM_INST_RVC_Q1_HI:
     {
         opcode &= 0xFFFF;
         rvc_decode rvc(opcode);
@@ -2050,8 +2716,9 @@ bool rv32::execute(void)
             take_exception = true;
         }
     }
+    break;
     // RVC - Quadrant 2
-    else if (m_enable_rvc && ((opcode & 3) == 2))
+    case ENUM_INST_RVC_Q2:
     {
         opcode &= 0xFFFF;
 
@@ -2193,11 +2860,14 @@ bool rv32::execute(void)
             take_exception = true;
         }
     }
-    else
+    break;
+    default:
     {
         exception(MCAUSE_ILLEGAL_INSTRUCTION, pc, opcode);
         take_exception = true;
     }
+    break;
+    }
 
     if (rd != 0 && !take_exception)
         m_gpr[rd] = reg_rd;
@@ -2205,32 +2875,21 @@ bool rv32::execute(void)
     // Monitor executed instructions
     log_commit_pc(m_pc_x);
 
-    // Pending interrupt
-    if (!take_exception && (m_csr_mip & m_csr_mie))
+    // Pending interrupt (cached, see irq_update)
+    if (!take_exception && m_irq_pending)
     {
-        uint32_t pending_interrupts = (m_csr_mip & m_csr_mie);
-        uint32_t m_enabled          = m_csr_mpriv < PRIV_MACHINE || (m_csr_mpriv == PRIV_MACHINE && (m_csr_msr & SR_MIE));
-        uint32_t s_enabled          = m_csr_mpriv < PRIV_SUPER   || (m_csr_mpriv == PRIV_SUPER   && (m_csr_msr & SR_SIE));
-        uint32_t m_interrupts       = pending_interrupts & ~m_csr_mideleg & -m_enabled;
-        uint32_t s_interrupts       = pending_interrupts & m_csr_mideleg & -s_enabled;
-        uint32_t interrupts         = m_interrupts ? m_interrupts : s_interrupts;
+        //printf("Take Interrupt...: %08x\n", m_irq_pending);
+        int i;
 
-        // Interrupt pending and mask enabled
-        if (interrupts)
+        for (i=IRQ_MIN;i<IRQ_MAX;i++)
         {
-            //printf("Take Interrupt...: %08x\n", interrupts);
-            int i;
-
-            for (i=IRQ_MIN;i<IRQ_MAX;i++)
+            if (m_irq_pending & (1 << i))
             {
-                if (interrupts & (1 << i))
-                {
-                    // Only service one interrupt per cycle
-                    DPRINTF(LOG_INST,( "Interrupt%d taken...\n", i));
-                    exception(MCAUSE_INTERRUPT + i, pc);
-                    take_exception = true;
-                    break;
-                }
+                // Only service one interrupt per cycle
+                DPRINTF(LOG_INST,( "Interrupt%d taken...\n", i));
+                exception(MCAUSE_INTERRUPT + i, pc);
+                take_exception = true;
+                break;
             }
         }
     }
@@ -2243,27 +2902,32 @@ bool rv32::execute(void)
 //-----------------------------------------------------------------
 // step: Step through one instruction
 //-----------------------------------------------------------------
-void rv32::step(void)
+template <int CFG>
+void rv32::step_cfg(void)
 {
     m_stats[STATS_INSTRUCTIONS]++;
 
     // Execute instruction at current PC
     int max_steps = 2;
-    while (max_steps-- && !execute())
+    while (max_steps-- && !execute_cfg<CFG>())
         ;
 
-    // Increment timer counter
-    m_csr_mtime++;
-
+    step_complete_cfg<CFG>();
+}
+//-----------------------------------------------------------------
+// step_complete: Timer, trace and device clocking after an instruction
+//-----------------------------------------------------------------
+template <int CFG>
+void rv32::step_complete_cfg(void)
+{
     // Non-std: Timer should generate an internal interrupt?
-    if (m_enable_mtimecmp)
+    // (mtime advances with the shared step count, see mtime_update)
+    if (time_now() >= m_csr_mtime_irq)
     {
-        // Limited internal timer, truncate to 32-bits
-        if ((m_csr_mtime & 0xFFFFFFFF) == m_csr_mtimecmp && m_csr_mtime_ie)
-        {
-            m_csr_mip     |= m_enable_sbi ? SR_IP_STIP : SR_IP_MTIP;
-            m_csr_mtime_ie = false;
-        }
+        m_csr_mip      |= m_enable_sbi ? SR_IP_STIP : SR_IP_MTIP;
+        m_csr_mtime_ie  = false;
+        m_csr_mtime_irq = ~(uint64_t)0;
+        irq_update();
     }
 
     // Dump state
@@ -2280,44 +2944,116 @@ void rv32::step(void)
 
     cpu::step();
 }
+
+#undef DPRINTF
+#undef TRACE_ENABLED
+#define DPRINTF(l,a)        do { if (m_trace & l) printf a; } while (0)
+#define TRACE_ENABLED(l)    (m_trace & l)
+
+//-----------------------------------------------------------------
+// exec_select: Pick execute path for the current configuration
+//-----------------------------------------------------------------
+void rv32::exec_select(void)
+{
+    static bool (rv32::*execute_fns[EXEC_CFGS])(void) =
+    {
+        &rv32::execute_cfg<0>,
+        &rv32::execute_cfg<EXEC_RVC>,
+        &rv32::execute_cfg<EXEC_TRACE>,
+        &rv32::execute_cfg<EXEC_TRACE | EXEC_RVC>
+    };
+    static void (rv32::*step_fns[EXEC_CFGS])(void) =
+    {
+        &rv32::step_cfg<0>,
+        &rv32::step_cfg<EXEC_RVC>,
+        &rv32::step_cfg<EXEC_TRACE>,
+        &rv32::step_cfg<EXEC_TRACE | EXEC_RVC>
+    };
+
+    int cfg = (m_enable_rvc ? EXEC_RVC : 0) | (m_trace ? EXEC_TRACE : 0);
+    m_execute = execute_fns[cfg];
+    m_step    = step_fns[cfg];
+}
+//-----------------------------------------------------------------
+// enable_trace: Set trace mask (and execute path)
+//-----------------------------------------------------------------
+void rv32::enable_trace(uint32_t mask)
+{
+    cpu::enable_trace(mask);
+    exec_select();
+    softmmu_flush();
+}
+//-----------------------------------------------------------------
+// execute: Execute instruction at current PC
+//-----------------------------------------------------------------
+bool rv32::execute(void)
+{
+    return (this->*m_execute)();
+}
+//-----------------------------------------------------------------
+// step: Step through one instruction
+//-----------------------------------------------------------------
+void rv32::step(void)
+{
+    (this->*m_step)();
+}
+//-----------------------------------------------------------------
+// step_complete: Complete a step retired outside of step()
+//-----------------------------------------------------------------
+void rv32::step_complete(void)
+{
+    if (m_trace)
+        step_complete_cfg<EXEC_TRACE>();
+    else
+        step_complete_cfg<0>();
+}
+//-----------------------------------------------------------------
+// irq_update: Recompute the pending & enabled interrupts (called on
+//             mip, mie, mideleg, mstatus or privilege level change)
+//-----------------------------------------------------------------
+void rv32::irq_update(void)
+{
+    uint32_t pending_interrupts = (m_csr_mip & m_csr_mie);
+    uint32_t m_enabled          = m_csr_mpriv < PRIV_MACHINE || (m_csr_mpriv == PRIV_MACHINE && (m_csr_msr & SR_MIE));
+    uint32_t s_enabled          = m_csr_mpriv < PRIV_SUPER   || (m_csr_mpriv == PRIV_SUPER   && (m_csr_msr & SR_SIE));
+    uint32_t m_interrupts       = pending_interrupts & ~m_csr_mideleg & -m_enabled;
+    uint32_t s_interrupts       = pending_interrupts & m_csr_mideleg & -s_enabled;
+
+    m_irq_pending = m_interrupts ? m_interrupts : s_interrupts;
+}
 //-----------------------------------------------------------------
 // set_interrupt: Register pending interrupt
 //-----------------------------------------------------------------
 void rv32::set_interrupt(int irq)
 {
-    assert(irq == IRQ_M_EXT || irq == IRQ_M_TIMER);
+    assert(irq == IRQ_M_EXT || irq == IRQ_M_TIMER || irq == IRQ_M_SOFT || irq == IRQ_S_SOFT);
     if (irq == IRQ_M_EXT)
 #ifdef CPU_INTERRUPT_MEIP_ONLY
         m_csr_mip |= (SR_IP_MEIP);
 #else
         m_csr_mip |= (SR_IP_MEIP | SR_IP_SEIP);
 #endif
+    else if (irq == IRQ_M_SOFT)
+        m_csr_mip |= SR_IP_MSIP;
+    else if (irq == IRQ_S_SOFT)
+        m_csr_mip |= SR_IP_SSIP;
     else if (!m_enable_mtimecmp)
         m_csr_mip |= SR_IP_MTIP;
 
+    irq_update();
+
 #ifdef CPU_INTERRUPT_ON_SET
     // Pending interrupt
-    if (m_csr_mip & m_csr_mie)
+    if (m_irq_pending)
     {
-        uint32_t pending_interrupts = (m_csr_mip & m_csr_mie);
-        uint32_t m_enabled          = m_csr_mpriv < PRIV_MACHINE || (m_csr_mpriv == PRIV_MACHINE && (m_csr_msr & SR_MIE));
-        uint32_t s_enabled          = m_csr_mpriv < PRIV_SUPER   || (m_csr_mpriv == PRIV_SUPER   && (m_csr_msr & SR_SIE));
-        uint32_t m_interrupts       = pending_interrupts & ~m_csr_mideleg & -m_enabled;
-        uint32_t s_interrupts       = pending_interrupts & m_csr_mideleg & -s_enabled;
-        uint32_t interrupts         = m_interrupts ? m_interrupts : s_interrupts;
-
-        // Interrupt pending and mask enabled
-        if (interrupts)
+        for (int i=IRQ_MIN;i<IRQ_MAX;i++)
         {
-            for (int i=IRQ_MIN;i<IRQ_MAX;i++)
+            if (m_irq_pending & (1 << i))
             {
-                if (interrupts & (1 << i))
-                {
-                    // Only service one interrupt per cycle
-                    DPRINTF(LOG_INST,( "Interrupt%d taken...\n", i));
-                    exception(MCAUSE_INTERRUPT + i, m_pc);
-                    break;
-                }
+                // Only service one interrupt per cycle
+                DPRINTF(LOG_INST,( "Interrupt%d taken...\n", i));
+                exception(MCAUSE_INTERRUPT + i, m_pc);
+                break;
             }
         }
     }
@@ -2328,9 +3064,13 @@ void rv32::set_interrupt(int irq)
 //-----------------------------------------------------------------
 void rv32::clr_interrupt(int irq)
 {
-    assert(irq == IRQ_M_TIMER || irq == IRQ_M_EXT);
+    assert(irq == IRQ_M_TIMER || irq == IRQ_M_EXT || irq == IRQ_M_SOFT || irq == IRQ_S_SOFT);
     if (irq == IRQ_M_TIMER && !m_enable_mtimecmp)
         m_csr_mip &= ~SR_IP_MTIP;
+    else if (irq == IRQ_M_SOFT)
+        m_csr_mip &= ~SR_IP_MSIP;
+    else if (irq == IRQ_S_SOFT)
+        m_csr_mip &= ~SR_IP_SSIP;
     else if (irq == IRQ_M_EXT)
     {
 #ifdef CPU_INTERRUPT_MEIP_ONLY
@@ -2339,6 +3079,8 @@ void rv32::clr_interrupt(int irq)
         m_csr_mip &= ~(SR_IP_MEIP | SR_IP_SEIP);
 #endif
     }
+
+    irq_update();
 }
 //-----------------------------------------------------------------
 // set_timer: Set built in timer interrupt
@@ -2348,7 +3090,34 @@ void rv32::set_timer(uint32_t value)
     m_enable_mtimecmp = true;
     m_csr_mtime_ie    = true;
     m_csr_mtimecmp    = value;
+    mtime_update();
     m_csr_mip        &= ~SR_IP_STIP;
+    irq_update();
+}
+//-----------------------------------------------------------------
+// mtime_write: Set mtime (which then counts on from val)
+//-----------------------------------------------------------------
+void rv32::mtime_write(uint64_t val)
+{
+    m_csr_mtime_base = time_now() - val;
+    mtime_update();
+}
+//-----------------------------------------------------------------
+// mtime_update: Find the step at which mtime will match mtimecmp
+//-----------------------------------------------------------------
+void rv32::mtime_update(void)
+{
+    // Limited internal timer, match on the low 32-bits of mtime
+    // (mtime is incremented at the end of each step, then compared)
+    uint64_t now   = mtime();
+    uint64_t match = (now & ~0xFFFFFFFFull) | m_csr_mtimecmp;
+    if (match <= now)
+        match += 1ull << 32;
+
+    if (m_enable_mtimecmp && m_csr_mtime_ie)
+        m_csr_mtime_irq = m_csr_mtime_base + match - 1;
+    else
+        m_csr_mtime_irq = ~(uint64_t)0;
 }
 //-----------------------------------------------------------------
 // in_super_mode: Is the CPU in SUPER mode
@@ -2367,12 +3136,48 @@ void rv32::sbi_boot(uint32_t boot_addr, uint32_t dtb_addr)
 
     m_csr_mideleg = ~0;
     m_csr_medeleg = ~MCAUSE_ECALL_S;
+    irq_update();
 
     m_pc = m_pc_x = boot_addr;
-    m_gpr[RISCV_REG_A0 + 0] = 0;
+    m_gpr[RISCV_REG_A0 + 0] = m_hartid;
     m_gpr[RISCV_REG_A0 + 1] = dtb_addr;
 }
 //-----------------------------------------------------------------
+// boot_hart: Start a secondary hart (a0 = hart ID, a1 = arg)
+//-----------------------------------------------------------------
+void rv32::boot_hart(uint32_t addr, uint64_t arg)
+{
+    int trace = m_trace;
+
+    reset(addr);
+
+    // Time carries on from the shared time base (see cpu::time_now)
+    mtime_write(time_now());
+    enable_trace(trace);
+
+    if (m_enable_sbi)
+        sbi_boot(addr, 0);
+
+    m_gpr[RISCV_REG_A0 + 0] = m_hartid;
+    m_gpr[RISCV_REG_A0 + 1] = arg;
+}
+//-----------------------------------------------------------------
+// remote_fence: Fences requested by another hart
+//-----------------------------------------------------------------
+void rv32::remote_fence(uint32_t fences)
+{
+    if (fences & CPU_FENCE_VMA)
+    {
+        m_mmu_flush_full++;
+        mmu_flush();
+    }
+    if (fences & CPU_FENCE_I)
+    {
+        m_mmu_fence_i++;
+        decode_flush();
+    }
+}
+//-----------------------------------------------------------------
 // stats_reset: Reset runtime stats
 //-----------------------------------------------------------------
 void rv32::stats_reset(void)
@@ -2380,6 +3185,18 @@ void rv32::stats_reset(void)
     // Clear stats
     for (int i=STATS_MIN;i<STATS_MAX;i++)
         m_stats[i] = 0;
+
+    skip_stats_reset();
+
+    m_itlb.hits      = 0;
+    m_itlb.misses    = 0;
+    m_dtlb.hits      = 0;
+    m_dtlb.misses    = 0;
+    m_mmu_walks      = 0;
+    m_mmu_pte_reads  = 0;
+    m_mmu_flush_full = 0;
+    m_mmu_flush_selective = 0;
+    m_mmu_fence_i    = 0;
 }
 //-----------------------------------------------------------------
 // stats_dump: Show execution stats
@@ -2397,5 +3214,21 @@ void rv32::stats_dump(void)
         printf( "- Division              %d (%d%%)\n", m_stats[STATS_DIV], (m_stats[STATS_DIV] * 100) / m_stats[STATS_INSTRUCTIONS]);
     }
 
+    if (m_mmu_walks)
+    {
+        printf( "- ITLB hits %llu misses %llu, DTLB hits %llu misses %llu\n",
+                (unsigned long long)m_itlb.hits, (unsigned long long)m_itlb.misses,
+                (unsigned long long)m_dtlb.hits, (unsigned long long)m_dtlb.misses);
+        printf( "- Page table walks %llu (%llu PTE reads)\n",
+                (unsigned long long)m_mmu_walks, (unsigned long long)m_mmu_pte_reads);
+    }
+
+    if (m_mmu_flush_full || m_mmu_flush_selective || m_mmu_fence_i)
+        printf( "- TLB flushes full %llu selective %llu, FENCE.I %llu\n",
+                (unsigned long long)m_mmu_flush_full, (unsigned long long)m_mmu_flush_selective,
+                (unsigned long long)m_mmu_fence_i);
+
+    skip_stats_dump();
+
     stats_reset();
 }
@@ -12,6 +12,7 @@
 #include <vector>
 #include "memory.h"
 #include "cpu.h"
+#include "tlb.h"
 
 //--------------------------------------------------------------------
 // rv32: RV32IM model
@@ -24,6 +25,7 @@ public:
     void                reset(uint32_t start_addr);
     uint32_t            get_opcode(uint32_t pc);
     void                step(void);
+    run_reason          run(uint64_t max_insts, const run_limits &limits);
 
     void                set_interrupt(int irq);
     void                clr_interrupt(int irq);
@@ -51,30 +53,122 @@ public:
     int                 get_abi_reg_num(void) { return 8; }
 
     // Enable / Disable ISA extensions
-    void                enable_rvm(bool en) { m_enable_rvm = en; }
-    void                enable_rvc(bool en) { m_enable_rvc = en; }
-    void                enable_rva(bool en) { m_enable_rva = en; }
+    void                enable_rvm(bool en) { m_enable_rvm = en; decode_flush(); exec_select(); }
+    void                enable_rvc(bool en) { m_enable_rvc = en; decode_flush(); exec_select(); }
+    void                enable_rva(bool en) { m_enable_rva = en; decode_flush(); exec_select(); }
+
+    // Trace output (selects the traced execute path)
+    void                enable_trace(uint32_t mask);
+
+    // TLB geometry (per I/D TLB)
+    void                configure_tlb(int sets, int ways);
+
+    // Pre-decoded instruction cache
+    void                enable_decode_cache(bool en);
+
+    // Superblock execution (see rv32_block.cpp)
+    void                enable_block_exec(bool en);
 
     // SBI hosting support
     bool                in_super_mode(void);
     void                set_timer(uint32_t value);
     void                sbi_boot(uint32_t boot_addr, uint32_t dtb_addr);
+    bool                read_data(uint32_t address, uint32_t *value, int width);
+
+    // Start a secondary hart
+    void                boot_hart(uint32_t addr, uint64_t arg);
 
 protected:  
     bool                execute(void);
     int                 load(uint32_t pc, uint32_t address, uint32_t *result, int width, bool signedLoad);
     int                 store(uint32_t pc, uint32_t address, uint32_t data, int width);
+    int                 amo(uint32_t pc, uint32_t address, uint32_t *result, uint32_t src, int op);
+    int                 load_reserved(uint32_t pc, uint32_t address, uint32_t *result);
+    int                 store_conditional(uint32_t pc, uint32_t address, uint32_t data, uint32_t *result);
     virtual bool        access_csr(uint32_t address, uint32_t data, bool set, bool clr, uint32_t &result);
     void                exception(uint32_t cause, uint32_t pc, uint32_t badaddr = 0);
+    void                irq_update(void);
+    void                step_complete(void);
+
+// Execute path specialised on RVC and trace state (see exec_select)
+private:
+    enum
+    {
+        EXEC_RVC   = (1 << 0),
+        EXEC_TRACE = (1 << 1),
+        EXEC_CFGS  = 4
+    };
+    template <int CFG> bool execute_cfg(void);
+    template <int CFG> void step_cfg(void);
+    template <int CFG> void step_complete_cfg(void);
+    void                exec_select(void);
+
+// Pre-decoded instruction cache
+private:
+    struct decode_entry;
+    void                decode(uint32_t opcode, decode_entry *d);
+    decode_entry*       decode_lookup(uint32_t address);
+    void                decode_invalidate(uint32_t address, int width);
+    void                decode_flush(void);
+
+// Timer (derived from the step count)
+private:
+    uint64_t            mtime(void) { return time_now() - m_csr_mtime_base; }
+    void                mtime_write(uint64_t val);
+    void                mtime_update(void);
+    uint64_t            timer_event(void) { return time_step(m_csr_mtime_irq); }
+
+// Superblock execution
+private:
+    struct block_inst;
+    struct superblock;
+    run_reason          run_blocks(uint64_t max_insts, const run_limits &limits);
+    superblock*         block_lookup(uint32_t pc);
+    bool                block_build(superblock *b, uint32_t pc);
+    bool                block_decode(uint32_t opcode, block_inst *i);
+    bool                block_decode_rvc(uint32_t opcode, block_inst *i);
+    int                 block_exec(superblock *b, uint64_t max_insts);
+    void                block_flush(void);
+    void                block_flush_page(uint32_t va);
+    void                block_invalidate(uint32_t address)
+    {
+        if (m_block_code && m_block_code[address >> BLOCK_PAGE_SHIFT] == m_block_gen)
+            block_flush();
+    }
 
 // MMU
 private:
     void                mmu_flush(void);
+    void                remote_fence(uint32_t fences);
     int                 mmu_read_word(uint32_t address, uint32_t *val);
-    uint32_t            mmu_walk(uint32_t addr);
-    int                 mmu_i_translate(uint32_t addr, uint32_t *physical);
+    uint32_t            mmu_walk(uint32_t addr, bool ifetch = false);
+    void                mmu_satp_write(uint32_t prev);
+    void                mmu_sfence(uint32_t addr, bool has_addr, uint32_t asid, bool has_asid);
+    int                 mmu_i_translate(uint32_t addr, uint32_t *physical, bool probe = false);
     int                 mmu_d_translate(uint32_t pc, uint32_t addr, uint32_t *physical, int writeNotRead);
 
+// Softmmu: virtual page -> physical / host page, per privilege and access type
+private:
+    enum { SOFTMMU_LOAD, SOFTMMU_STORE, SOFTMMU_FETCH, SOFTMMU_TYPES };
+    static const int      SOFTMMU_ENTRIES    = 256;
+    static const int      SOFTMMU_PAGE_SHIFT = 12;
+    static const uint32_t SOFTMMU_PAGE_MASK  = (1 << SOFTMMU_PAGE_SHIFT) - 1;
+    struct softmmu_entry
+    {
+        uint32_t        vpn;    // Virtual page number (~0 = invalid)
+        uint32_t        phys;   // Physical page address
+        uint8_t        *host;   // Host page (NULL if not RAM backed, e.g. MMIO)
+        int             level;  // Level of the PTE (0 = base page)
+    };
+    softmmu_entry      *softmmu_lookup(int type, int priv, uint32_t va)
+    {
+        return &m_softmmu[priv & 3][type][(va >> SOFTMMU_PAGE_SHIFT) & (SOFTMMU_ENTRIES-1)];
+    }
+    uint32_t            data_priv(void);
+    void                softmmu_fill(int type, int priv, uint32_t va, uint32_t pa, int level);
+    void                softmmu_flush(void);
+    void                softmmu_flush_page(uint32_t va);
+
 private:
 
     // CPU Registers
@@ -82,6 +176,7 @@ private:
     uint32_t            m_pc;
     uint32_t            m_pc_x;
     uint32_t            m_load_res;
+    uint32_t            m_load_val;
 
     // CSR - Machine
     uint32_t            m_csr_mepc;
@@ -92,7 +187,9 @@ private:
     uint32_t            m_csr_mtval;
     uint32_t            m_csr_mie;
     uint32_t            m_csr_mip;
-    uint64_t            m_csr_mtime;
+    uint32_t            m_irq_pending;    // Deliverable interrupts (see irq_update)
+    uint64_t            m_csr_mtime_base; // mtime = steps - base
+    uint64_t            m_csr_mtime_irq;  // Step at which mtimecmp matches
     uint32_t            m_csr_mtimecmp;
     bool                m_csr_mtime_ie;
     uint32_t            m_csr_mscratch;
@@ -107,10 +204,76 @@ private:
     uint32_t            m_csr_satp;
     uint32_t            m_csr_sscratch;
 
-    // TLB cache
-    static const int MMU_TLB_ENTRIES = 64;
-    uint32_t            m_mmu_addr[MMU_TLB_ENTRIES];
-    uint32_t            m_mmu_pte[MMU_TLB_ENTRIES];
+    // TLBs (ASID tagged, see tlb.h)
+    tlb                 m_itlb;
+    tlb                 m_dtlb;
+    uint64_t            m_mmu_walks;
+    uint64_t            m_mmu_pte_reads;
+    uint64_t            m_mmu_flush_full;
+    uint64_t            m_mmu_flush_selective;
+    uint64_t            m_mmu_fence_i;
+    int                 m_mmu_level;    // PTE level of the last walk / TLB hit
+    softmmu_entry       m_softmmu[4][SOFTMMU_TYPES][SOFTMMU_ENTRIES];
+    bool                m_softmmu_super; // Superpage entries present
+
+    // Pre-decoded instruction cache (physically tagged, 2 byte slots).
+    // An entry is valid when its generation matches the owning page.
+    struct decode_entry
+    {
+        uint32_t        opcode;
+        int32_t         imm;
+        uint32_t        gen;
+        uint16_t        inst;
+        uint8_t         rd;
+        uint8_t         rs1;
+        uint8_t         rs2;
+        uint8_t         shamt;
+    };
+    static const int      DECODE_PAGES       = 64;
+    static const int      DECODE_PAGE_SHIFT  = 12;
+    static const uint32_t DECODE_PAGE_MASK   = (1 << DECODE_PAGE_SHIFT) - 1;
+    static const int      DECODE_SLOTS       = (1 << DECODE_PAGE_SHIFT) / 2;
+    static const uint32_t DECODE_TAG_INVALID = ~0U;
+    struct decode_page
+    {
+        uint32_t        tag;
+        uint32_t        gen;
+        decode_entry    slot[DECODE_SLOTS];
+    };
+    decode_page        *m_decode_cache;
+
+    // Superblocks (virtually tagged, direct mapped). Blocks and code page
+    // markers are valid while their generation matches m_block_gen.
+    static const int      BLOCK_MAX_INSTS    = 64;
+    static const int      BLOCK_CACHE_SIZE   = 2048;
+    static const int      BLOCK_PAGE_SHIFT   = 12;
+    static const uint32_t BLOCK_PAGE_MASK    = (1 << BLOCK_PAGE_SHIFT) - 1;
+    struct block_inst
+    {
+        void           *op;     // Handler (resolved on first execution)
+        int32_t         imm;
+        uint16_t        inst;
+        uint16_t        offset; // From block start PC
+        uint8_t         rd;
+        uint8_t         rs1;
+        uint8_t         rs2;
+        uint8_t         len;
+    };
+    struct superblock
+    {
+        uint32_t        pc;
+        uint32_t        priv;
+        uint32_t        gen;
+        int             count;
+        bool            resolved;
+        int             level;   // PTE level of the page mapping pc
+        superblock     *link[2]; // Chained successors (fall through / taken)
+        block_inst      inst[BLOCK_MAX_INSTS];
+    };
+    superblock         *m_block_cache;
+    uint32_t           *m_block_code;   // Per physical page (generation)
+    uint32_t            m_block_gen;
+    int                 m_block_exit;   // Successor slot of last exit (or -1)
 
     // Settings
     bool                m_enable_unaligned;
@@ -119,6 +282,8 @@ private:
     bool                m_enable_rvm;
     bool                m_enable_rvc;
     bool                m_enable_rva;
+    bool                (rv32::*m_execute)(void);
+    void                (rv32::*m_step)(void);
     bool                m_enable_mtimecmp;
     bool                m_enable_sbi;
 
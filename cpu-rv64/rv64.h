@@ -12,6 +12,7 @@
 #include <vector>
 #include "memory.h"
 #include "cpu.h"
+#include "tlb.h"
 
 //--------------------------------------------------------------------
 // rv64: RV64IM model
@@ -24,6 +25,7 @@ public:
     void                reset(uint32_t start_addr);
     uint32_t            get_opcode(uint64_t pc);
     void                step(void);
+    run_reason          run(uint64_t max_insts, const run_limits &limits);
 
     void                set_interrupt(int irq);
     void                clr_interrupt(int irq);
@@ -56,14 +58,33 @@ public:
     int                 get_abi_reg_num(void) { return 8; }
 
     // Enable / Disable ISA extensions
-    void                enable_rvm(bool en) { m_enable_rvm = en; }
-    void                enable_rvc(bool en) { m_enable_rvc = en; }
-    void                enable_rva(bool en) { m_enable_rva = en; }
+    void                enable_rvm(bool en) { m_enable_rvm = en; decode_flush(); exec_select(); }
+    void                enable_rvc(bool en) { m_enable_rvc = en; decode_flush(); exec_select(); }
+    void                enable_rva(bool en) { m_enable_rva = en; decode_flush(); exec_select(); }
+
+    // Trace output (selects the traced execute path)
+    void                enable_trace(uint32_t mask);
+
+    // TLB geometry (per I/D TLB)
+    void                configure_tlb(int sets, int ways);
+
+    // Pre-decoded instruction cache
+    void                enable_decode_cache(bool en);
+
+    // Superblock execution (see rv64_block.cpp)
+    void                enable_block_exec(bool en);
+
+    // Translate hot superblocks to host code (see rv64_dbt.cpp)
+    void                enable_dbt(bool en);
 
     // SBI hosting support
     void                set_timer(uint64_t value);
     bool                in_super_mode(void);
     void                sbi_boot(uint32_t boot_addr, uint32_t dtb_addr);
+    bool                read_data(uint64_t address, uint64_t *value, int width);
+
+    // Start a secondary hart
+    void                boot_hart(uint32_t addr, uint64_t arg);
 
     enum eStats
     { 
@@ -79,17 +100,101 @@ protected:
     bool                execute(void);
     int                 load(uint64_t pc, uint64_t address, uint64_t *result, int width, bool signedLoad);
     int                 store(uint64_t pc, uint64_t address, uint64_t data, int width);
+    int                 amo(uint64_t pc, uint64_t address, uint64_t *result, uint64_t src, int op, int width);
+    int                 load_reserved(uint64_t pc, uint64_t address, uint64_t *result, int width);
+    int                 store_conditional(uint64_t pc, uint64_t address, uint64_t data, uint64_t *result, int width);
     virtual bool        access_csr(uint64_t address, uint64_t data, bool set, bool clr, uint64_t &result);
     void                exception(uint64_t cause, uint64_t pc, uint64_t badaddr = 0);
+    void                irq_update(void);
+    void                step_complete(void);
+
+// Execute path specialised on RVC and trace state (see exec_select)
+private:
+    enum
+    {
+        EXEC_RVC   = (1 << 0),
+        EXEC_TRACE = (1 << 1),
+        EXEC_CFGS  = 4
+    };
+    template <int CFG> bool execute_cfg(void);
+    template <int CFG> void step_cfg(void);
+    template <int CFG> void step_complete_cfg(void);
+    void                exec_select(void);
+
+// Pre-decoded instruction cache
+private:
+    struct decode_entry;
+    void                decode(uint32_t opcode, decode_entry *d);
+    decode_entry*       decode_lookup(uint64_t address);
+    void                decode_invalidate(uint64_t address, int width);
+    void                decode_flush(void);
+
+// Timer (derived from the step count)
+private:
+    uint64_t            mtime(void) { return time_now() - m_csr_mtime_base; }
+    void                mtime_write(uint64_t val);
+    void                mtime_update(void);
+    uint64_t            timer_event(void) { return time_step(m_csr_mtime_irq); }
+
+// Superblock execution
+private:
+    struct block_inst;
+    struct superblock;
+    run_reason          run_blocks(uint64_t max_insts, const run_limits &limits);
+    superblock*         block_lookup(uint64_t pc);
+    bool                block_build(superblock *b, uint64_t pc);
+    bool                block_decode(uint32_t opcode, block_inst *i);
+    bool                block_decode_rvc(uint32_t opcode, block_inst *i);
+    int                 block_exec(superblock *b, uint64_t max_insts);
+    void                block_flush(void);
+    void                block_flush_page(uint64_t va);
+    void                block_invalidate(uint64_t address)
+    {
+        if (m_block_code && m_block_code[address >> BLOCK_PAGE_SHIFT] == m_block_gen)
+            block_flush();
+    }
+
+// Dynamic binary translation (x86-64 hosts)
+private:
+    bool                dbt_translate(superblock *b);
+    void                dbt_stats_dump(void);
+    void                dbt_stats_reset(void);
+    static int          dbt_mem(rv64 *c, superblock *b, int idx);
+    static uint64_t     dbt_div(uint64_t a, uint64_t b, int inst);
 
 // MMU
 private:
     void                mmu_flush(void);
+    void                remote_fence(uint32_t fences);
     int                 mmu_read_word(uint64_t address, uint64_t *val);
-    uint64_t            mmu_walk(uint64_t addr);
-    int                 mmu_i_translate(uint64_t addr, uint64_t *physical);
+    uint64_t            mmu_walk(uint64_t addr, bool ifetch = false);
+    void                mmu_satp_write(uint64_t prev);
+    void                mmu_sfence(uint64_t addr, bool has_addr, uint64_t asid, bool has_asid);
+    int                 mmu_i_translate(uint64_t addr, uint64_t *physical, bool probe = false);
     int                 mmu_d_translate(uint64_t pc, uint64_t addr, uint64_t *physical, int writeNotRead);
 
+// Softmmu: virtual page -> physical / host page, per privilege and access type
+private:
+    enum { SOFTMMU_LOAD, SOFTMMU_STORE, SOFTMMU_FETCH, SOFTMMU_TYPES };
+    static const int      SOFTMMU_ENTRIES    = 256;
+    static const int      SOFTMMU_PAGE_SHIFT = 12;
+    static const uint64_t SOFTMMU_PAGE_MASK  = (1 << SOFTMMU_PAGE_SHIFT) - 1;
+    struct softmmu_entry
+    {
+        uint64_t        vpn;    // Virtual page number (~0 = invalid)
+        uint64_t        phys;   // Physical page address
+        uint8_t        *host;   // Host page (NULL if not RAM backed, e.g. MMIO)
+        int             level;  // Level of the PTE (0 = base page)
+    };
+    softmmu_entry      *softmmu_lookup(int type, int priv, uint64_t va)
+    {
+        return &m_softmmu[priv & 3][type][(va >> SOFTMMU_PAGE_SHIFT) & (SOFTMMU_ENTRIES-1)];
+    }
+    uint32_t            data_priv(void);
+    void                softmmu_fill(int type, int priv, uint64_t va, uint64_t pa, int level);
+    void                softmmu_flush(void);
+    void                softmmu_flush_page(uint64_t va);
+
 private:
 
     // CPU Registers
@@ -97,6 +202,7 @@ private:
     uint64_t            m_pc;
     uint64_t            m_pc_x;
     uint64_t            m_load_res;
+    uint64_t            m_load_val;
 
     // CSR - Machine
     uint64_t            m_csr_mepc;
@@ -107,7 +213,9 @@ private:
     uint64_t            m_csr_mtval;
     uint64_t            m_csr_mie;
     uint64_t            m_csr_mip;
-    uint64_t            m_csr_mtime;
+    uint64_t            m_irq_pending;    // Deliverable interrupts (see irq_update)
+    uint64_t            m_csr_mtime_base; // mtime = steps - base
+    uint64_t            m_csr_mtime_irq;  // Step at which mtimecmp matches
     uint64_t            m_csr_mtimecmp;
     bool                m_csr_mtime_ie;
     uint64_t            m_csr_mscratch;
@@ -122,10 +230,88 @@ private:
     uint64_t            m_csr_satp;
     uint64_t            m_csr_sscratch;
 
-    // TLB cache
-    static const int MMU_TLB_ENTRIES = 64;
-    uint64_t            m_mmu_addr[MMU_TLB_ENTRIES];
-    uint64_t            m_mmu_pte[MMU_TLB_ENTRIES];
+    // TLBs (ASID tagged, see tlb.h)
+    tlb                 m_itlb;
+    tlb                 m_dtlb;
+    uint64_t            m_mmu_walks;
+    uint64_t            m_mmu_pte_reads;
+    uint64_t            m_mmu_flush_full;
+    uint64_t            m_mmu_flush_selective;
+    uint64_t            m_mmu_fence_i;
+    int                 m_mmu_level;    // PTE level of the last walk / TLB hit
+    softmmu_entry       m_softmmu[4][SOFTMMU_TYPES][SOFTMMU_ENTRIES];
+    bool                m_softmmu_super; // Superpage entries present
+
+    // Pre-decoded instruction cache (physically tagged, 2 byte slots).
+    // An entry is valid when its generation matches the owning page.
+    struct decode_entry
+    {
+        uint32_t        opcode;
+        int32_t         imm;
+        uint32_t        gen;
+        uint16_t        inst;
+        uint8_t         rd;
+        uint8_t         rs1;
+        uint8_t         rs2;
+        uint8_t         shamt;
+    };
+    static const int      DECODE_PAGES       = 64;
+    static const int      DECODE_PAGE_SHIFT  = 12;
+    static const uint64_t DECODE_PAGE_MASK   = (1 << DECODE_PAGE_SHIFT) - 1;
+    static const int      DECODE_SLOTS       = (1 << DECODE_PAGE_SHIFT) / 2;
+    static const uint64_t DECODE_TAG_INVALID = ~0ULL;
+    struct decode_page
+    {
+        uint64_t        tag;
+        uint32_t        gen;
+        decode_entry    slot[DECODE_SLOTS];
+    };
+    decode_page        *m_decode_cache;
+
+    // Superblocks (virtually tagged, direct mapped). Blocks and code page
+    // markers are valid while their generation matches m_block_gen.
+    static const int      BLOCK_MAX_INSTS    = 64;
+    static const int      BLOCK_CACHE_SIZE   = 2048;
+    static const int      BLOCK_PAGE_SHIFT   = 12;
+    static const uint32_t BLOCK_PAGE_MASK    = (1 << BLOCK_PAGE_SHIFT) - 1;
+    struct block_inst
+    {
+        void           *op;     // Handler (resolved on first execution)
+        int64_t         imm;
+        uint16_t        inst;
+        uint16_t        offset; // From block start PC
+        uint8_t         rd;
+        uint8_t         rs1;
+        uint8_t         rs2;
+        uint8_t         len;
+    };
+    struct superblock
+    {
+        uint64_t        pc;
+        uint64_t        priv;
+        uint32_t        gen;
+        int             count;
+        bool            resolved;
+        int             level;   // PTE level of the page mapping pc
+        uint32_t        execs;
+        void           *native;  // Translated code (or NULL)
+        superblock     *link[2]; // Chained successors (fall through / taken)
+        block_inst      inst[BLOCK_MAX_INSTS];
+    };
+    superblock         *m_block_cache;
+    uint32_t           *m_block_code;   // Per physical page (generation)
+    uint32_t            m_block_gen;
+    int                 m_block_exit;   // Successor slot of last exit (or -1)
+
+    // Translated code buffer (reclaimed when all superblocks are flushed)
+    static const int    DBT_HOT          = 32;
+    static const size_t DBT_CODE_SIZE    = 16 << 20;
+    uint8_t            *m_dbt_code;
+    size_t              m_dbt_used;
+    uint64_t            m_dbt_start;    // Step count at native block entry
+    uint64_t            m_dbt_blocks;
+    uint64_t            m_dbt_runs;
+    uint64_t            m_dbt_insts;
 
     // Settings
     bool                m_enable_unaligned;
@@ -134,6 +320,8 @@ private:
     bool                m_enable_rvm;
     bool                m_enable_rvc;
     bool                m_enable_rva;
+    bool                (rv64::*m_execute)(void);
+    void                (rv64::*m_step)(void);
     bool                m_enable_mtimecmp;
     bool                m_enable_sbi;
 
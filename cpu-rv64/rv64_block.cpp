@@ -0,0 +1,875 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "rv64.h"
+#include "rv64_isa.h"
+#include "rv64_block.h"
+
+//-----------------------------------------------------------------
+// Superblock execution:
+// Straight line code is decoded into superblocks (ending at a branch,
+// jump, the end of a page or any instruction not handled here) which
+// are executed with computed goto dispatch and chained to their
+// successors.
+// Instructions are only retired inline while no device deadline,
+// timer match or interrupt can occur, otherwise execution drops back
+// to step() so mtime / minstret and traps are exactly as before.
+//-----------------------------------------------------------------
+
+//-----------------------------------------------------------------
+// enable_block_exec: Enable / disable superblock execution
+//-----------------------------------------------------------------
+void rv64::enable_block_exec(bool en)
+{
+    if (en && !m_block_cache)
+    {
+        m_block_cache = new superblock[BLOCK_CACHE_SIZE];
+        m_block_code  = new uint32_t[1 << (32 - BLOCK_PAGE_SHIFT)];
+        memset(m_block_cache, 0, sizeof(superblock) * BLOCK_CACHE_SIZE);
+        memset(m_block_code, 0, sizeof(uint32_t) << (32 - BLOCK_PAGE_SHIFT));
+        m_block_gen  = 1;
+        m_block_exit = -1;
+    }
+    else if (!en && m_block_cache)
+    {
+        delete [] m_block_cache;
+        delete [] m_block_code;
+        m_block_cache = NULL;
+        m_block_code  = NULL;
+    }
+}
+//-----------------------------------------------------------------
+// block_flush: Invalidate all superblocks
+//-----------------------------------------------------------------
+void rv64::block_flush(void)
+{
+    if (!m_block_cache)
+        return;
+
+    // Translations are dropped with their blocks
+    m_dbt_used = 0;
+
+    if (++m_block_gen == 0)
+    {
+        for (int i=0;i<BLOCK_CACHE_SIZE;i++)
+            m_block_cache[i].gen = 0;
+        memset(m_block_code, 0, sizeof(uint32_t) << (32 - BLOCK_PAGE_SHIFT));
+        m_block_gen = 1;
+    }
+}
+//-----------------------------------------------------------------
+// block_flush_page: Invalidate superblocks fetched through the
+// mapping of a virtual address (sfence.vma)
+//-----------------------------------------------------------------
+void rv64::block_flush_page(uint64_t va)
+{
+    if (!m_block_cache)
+        return;
+
+    for (int i=0;i<BLOCK_CACHE_SIZE;i++)
+    {
+        superblock *b = &m_block_cache[i];
+
+        // Machine mode fetches are not translated
+        if (b->gen != m_block_gen || b->priv > PRIV_SUPER)
+            continue;
+
+        if (((b->pc ^ va) >> (MMU_PGSHIFT + b->level * MMU_PTIDXBITS)) == 0)
+            b->gen = 0;
+    }
+}
+//-----------------------------------------------------------------
+// run: Execute up to max_insts instructions
+//-----------------------------------------------------------------
+run_reason rv64::run(uint64_t max_insts, const run_limits &limits)
+{
+    // Superblocks skip the per instruction trace / breakpoint checks
+    if (m_block_cache && !m_trace && !m_has_breakpoints &&
+        limits.stop_pc == 0xFFFFFFFF && limits.trace_pc == 0xFFFFFFFF)
+        return run_blocks(max_insts, limits);
+
+    return run_loop(this, max_insts, limits);
+}
+//-----------------------------------------------------------------
+// run_blocks: Execute superblocks (or single steps where required)
+//-----------------------------------------------------------------
+run_reason rv64::run_blocks(uint64_t max_insts, const run_limits &limits)
+{
+    superblock *prev = NULL;
+
+    while (!m_fault && !m_stopped && !limits.aborted())
+    {
+        if (max_insts == 0)
+            return RUN_LIMIT;
+
+        superblock *b = NULL;
+        int         n = 0;
+
+        // Interrupts are taken by execute()
+        if (!m_irq_pending)
+        {
+            // Follow chained successor (if still valid)
+            if (prev && m_block_exit >= 0)
+            {
+                b = prev->link[m_block_exit];
+                if (!b || b->gen != m_block_gen || b->pc != m_pc || b->priv != m_csr_mpriv)
+                    b = prev->link[m_block_exit] = block_lookup(m_pc);
+            }
+            else
+                b = block_lookup(m_pc);
+
+            if (b)
+                n = block_exec(b, max_insts);
+        }
+
+        if (n == 0)
+        {
+            step();
+            n = 1;
+            b = NULL;
+        }
+
+        prev       = b;
+        max_insts -= n;
+
+        if (m_break && limits.stop_on_break)
+        {
+            m_break = false;
+            return RUN_BREAK;
+        }
+    }
+
+    return m_fault ? RUN_FAULT : m_stopped ? RUN_STOPPED : RUN_ABORT;
+}
+//-----------------------------------------------------------------
+// block_lookup: Find (or build) superblock starting at virtual PC
+//-----------------------------------------------------------------
+rv64::superblock *rv64::block_lookup(uint64_t pc)
+{
+    // Misaligned fetch traps in execute()
+    if (pc & (m_enable_rvc ? 1 : 3))
+        return NULL;
+
+    superblock *b = &m_block_cache[(pc >> 1) & (BLOCK_CACHE_SIZE-1)];
+    if (b->gen == m_block_gen && b->pc == pc && b->priv == m_csr_mpriv)
+        return b;
+
+    return block_build(b, pc) ? b : NULL;
+}
+//-----------------------------------------------------------------
+// block_build: Decode superblock from RAM (to the end of the page)
+//-----------------------------------------------------------------
+bool rv64::block_build(superblock *b, uint64_t pc)
+{
+    uint64_t phys = pc;
+
+    b->gen = 0;
+
+    // Page faults are raised by execute()
+    if (!mmu_i_translate(pc, &phys, true) || (phys >> 32))
+        return false;
+
+    uint8_t *host = find_host_page(phys & ~(uint64_t)BLOCK_PAGE_MASK, BLOCK_PAGE_MASK + 1);
+    if (!host)
+        return false;
+
+    uint32_t offset = phys & BLOCK_PAGE_MASK;
+    int      count  = 0;
+    bool     end    = false;
+
+    while (!end && count < BLOCK_MAX_INSTS-1)
+    {
+        block_inst *i = &b->inst[count];
+
+        // Instructions straddling the page end are left to execute()
+        uint16_t opc16;
+        uint32_t opcode;
+        if (offset + 2 > BLOCK_PAGE_MASK + 1)
+            break;
+        memcpy(&opc16, host + offset, 2);
+
+        if (!m_enable_rvc || (opc16 & 3) == 3)
+        {
+            if (offset + 4 > BLOCK_PAGE_MASK + 1)
+                break;
+            memcpy(&opcode, host + offset, 4);
+            i->len = 4;
+        }
+        else
+        {
+            opcode = opc16;
+            i->len = 2;
+        }
+
+        i->offset = offset - (phys & BLOCK_PAGE_MASK);
+
+        bool ok = (i->len == 2) ? block_decode_rvc(opcode, i) : block_decode(opcode, i);
+        if (!ok)
+        {
+            i->inst = BLOCK_OP_STEP;
+            end     = true;
+        }
+        else
+        {
+            switch (i->inst)
+            {
+                case ENUM_INST_JAL:
+                case ENUM_INST_JALR:
+                case ENUM_INST_BEQ:
+                case ENUM_INST_BNE:
+                case ENUM_INST_BLT:
+                case ENUM_INST_BGE:
+                case ENUM_INST_BLTU:
+                case ENUM_INST_BGEU:
+                    end = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        offset += i->len;
+        count++;
+    }
+
+    if (count == 0)
+        return false;
+
+    // Fall through into the next block
+    if (!end)
+    {
+        block_inst *i = &b->inst[count++];
+        memset(i, 0, sizeof(*i));
+        i->inst   = BLOCK_OP_EXIT;
+        i->offset = offset - (phys & BLOCK_PAGE_MASK);
+    }
+
+    b->pc       = pc;
+    b->priv     = m_csr_mpriv;
+    b->level    = m_mmu_level;
+    b->count    = count;
+    b->resolved = false;
+    b->execs    = 0;
+    b->native   = NULL;
+    b->link[0]  = NULL;
+    b->link[1]  = NULL;
+    b->gen      = m_block_gen;
+
+    // Stores to this page flush the superblocks
+    m_block_code[phys >> BLOCK_PAGE_SHIFT] = m_block_gen;
+    return true;
+}
+//-----------------------------------------------------------------
+// block_decode: Decode 32-bit opcode (false if not handled inline)
+//-----------------------------------------------------------------
+bool rv64::block_decode(uint32_t opcode, block_inst *i)
+{
+    decode_entry d;
+    decode(opcode, &d);
+
+    i->inst = d.inst;
+    i->rd   = d.rd;
+    i->rs1  = d.rs1;
+    i->rs2  = d.rs2;
+    i->imm  = d.imm;
+
+    switch (d.inst)
+    {
+        case ENUM_INST_SLLI:
+        case ENUM_INST_SRLI:
+        case ENUM_INST_SRAI:
+            i->imm = d.shamt;
+            return true;
+        case ENUM_INST_SLLIW:
+        case ENUM_INST_SRLIW:
+        case ENUM_INST_SRAIW:
+            i->imm = d.shamt & SHIFT_MASK32;
+            return true;
+        case ENUM_INST_ANDI:
+        case ENUM_INST_ORI:
+        case ENUM_INST_XORI:
+        case ENUM_INST_ADDI:
+        case ENUM_INST_SLTI:
+        case ENUM_INST_SLTIU:
+        case ENUM_INST_LUI:
+        case ENUM_INST_AUIPC:
+        case ENUM_INST_ADD:
+        case ENUM_INST_SUB:
+        case ENUM_INST_SLT:
+        case ENUM_INST_SLTU:
+        case ENUM_INST_XOR:
+        case ENUM_INST_OR:
+        case ENUM_INST_AND:
+        case ENUM_INST_SLL:
+        case ENUM_INST_SRL:
+        case ENUM_INST_SRA:
+        case ENUM_INST_ADDIW:
+        case ENUM_INST_ADDW:
+        case ENUM_INST_SUBW:
+        case ENUM_INST_SLLW:
+        case ENUM_INST_SRLW:
+        case ENUM_INST_SRAW:
+        case ENUM_INST_MUL:
+        case ENUM_INST_DIV:
+        case ENUM_INST_DIVU:
+        case ENUM_INST_REM:
+        case ENUM_INST_REMU:
+        case ENUM_INST_MULW:
+        case ENUM_INST_DIVW:
+        case ENUM_INST_DIVUW:
+        case ENUM_INST_REMW:
+        case ENUM_INST_REMUW:
+        case ENUM_INST_LB:
+        case ENUM_INST_LH:
+        case ENUM_INST_LW:
+        case ENUM_INST_LBU:
+        case ENUM_INST_LHU:
+        case ENUM_INST_LWU:
+        case ENUM_INST_LD:
+        case ENUM_INST_SB:
+        case ENUM_INST_SH:
+        case ENUM_INST_SW:
+        case ENUM_INST_SD:
+        case ENUM_INST_JAL:
+        case ENUM_INST_JALR:
+        case ENUM_INST_BEQ:
+        case ENUM_INST_BNE:
+        case ENUM_INST_BLT:
+        case ENUM_INST_BGE:
+        case ENUM_INST_BLTU:
+        case ENUM_INST_BGEU:
+            return true;
+        default:
+            return false;
+    }
+}
+//-----------------------------------------------------------------
+// block_decode_rvc: Expand 16-bit opcode into its 32-bit equivalent
+// (false if not handled inline)
+//-----------------------------------------------------------------
+bool rv64::block_decode_rvc(uint32_t opcode, block_inst *i)
+{
+    decode_entry d;
+    decode(opcode, &d);
+
+    rvc_decode rvc(opcode);
+    int funct3 = opcode >> 13;
+
+    switch (d.inst)
+    {
+    case ENUM_INST_RVC_Q0:
+    {
+        i->rs1 = rvc.rs1s();
+        i->rs2 = rvc.rs2s();
+        i->rd  = i->rs2;
+
+        // C.ADDI4SPN
+        if (funct3 == 0 && opcode != 0)
+        {
+            i->inst = ENUM_INST_ADDI;
+            i->rs1  = RISCV_REG_SP;
+            i->imm  = rvc.addi4spn_imm();
+        }
+        // C.LW / C.LD / C.SW / C.SD
+        else if (funct3 == 2 || funct3 == 6)
+        {
+            i->inst = (funct3 == 2) ? ENUM_INST_LW : ENUM_INST_SW;
+            i->imm  = rvc.lw_imm();
+        }
+        else if (funct3 == 3 || funct3 == 7)
+        {
+            i->inst = (funct3 == 3) ? ENUM_INST_LD : ENUM_INST_SD;
+            i->imm  = rvc.ld_imm();
+        }
+        else
+            return false;
+    }
+    break;
+    case ENUM_INST_RVC_Q1_LO:
+    {
+        i->rs1 = rvc.rs1();
+        i->rs2 = rvc.rs2();
+        i->rd  = i->rs1;
+
+        // C.ADDI / C.ADDIW
+        if (funct3 == 0 || funct3 == 1)
+        {
+            i->inst = (funct3 == 0) ? ENUM_INST_ADDI : ENUM_INST_ADDIW;
+            i->imm  = rvc.imm();
+        }
+        // C.LI
+        else if (funct3 == 2)
+        {
+            i->inst = ENUM_INST_ADDI;
+            i->rs1  = 0;
+            i->imm  = rvc.imm();
+        }
+        // C.ADDI16SP
+        else if (funct3 == 3 && ((opcode >> 7) & 0x1f) == 2)
+        {
+            i->inst = ENUM_INST_ADDI;
+            i->rd   = RISCV_REG_SP;
+            i->rs1  = RISCV_REG_SP;
+            i->imm  = rvc.addi16sp_imm();
+        }
+        // C.LUI
+        else if (funct3 == 3)
+        {
+            i->inst = ENUM_INST_LUI;
+            i->imm  = rvc.imm() << 12;
+        }
+        else
+            return false;
+    }
+    break;
+    case ENUM_INST_RVC_Q1_HI:
+    {
+        int funct2 = (opcode >> 10) & 0x3;
+        int op     = (opcode >> 5) & 0x3;
+
+        i->rs1 = rvc.rs1s();
+        i->rs2 = rvc.rs2s();
+        i->rd  = i->rs1;
+
+        // C.SRLI / C.SRAI / C.ANDI
+        if (funct3 == 4 && funct2 != 3)
+        {
+            static const uint16_t insts[] = { ENUM_INST_SRLI, ENUM_INST_SRAI, ENUM_INST_ANDI };
+            i->inst = insts[funct2];
+            i->imm  = (funct2 == 2) ? rvc.imm() : rvc.zimm();
+        }
+        // C.SUB / C.XOR / C.OR / C.AND
+        else if (funct3 == 4 && ((opcode >> 10) & 0x7) == 3)
+        {
+            static const uint16_t insts[] = { ENUM_INST_SUB, ENUM_INST_XOR, ENUM_INST_OR, ENUM_INST_AND };
+            i->inst = insts[op];
+        }
+        // C.SUBW / C.ADDW
+        else if (funct3 == 4 && ((opcode >> 10) & 0x7) == 7 && op < 2)
+        {
+            i->inst = (op == 0) ? ENUM_INST_SUBW : ENUM_INST_ADDW;
+        }
+        // C.J
+        else if (funct3 == 5)
+        {
+            i->inst = ENUM_INST_JAL;
+            i->rd   = 0;
+            i->imm  = rvc.j_imm();
+        }
+        // C.BEQZ / C.BNEZ
+        else if (funct3 == 6 || funct3 == 7)
+        {
+            i->inst = (funct3 == 6) ? ENUM_INST_BEQ : ENUM_INST_BNE;
+            i->rs2  = 0;
+            i->imm  = rvc.b_imm();
+        }
+        else
+            return false;
+    }
+    break;
+    case ENUM_INST_RVC_Q2:
+    {
+        i->rs1 = rvc.rs1();
+        i->rs2 = rvc.rs2();
+        i->rd  = i->rs1;
+
+        // C.SLLI
+        if (funct3 == 0)
+        {
+            i->inst = ENUM_INST_SLLI;
+            i->imm  = rvc.zimm();
+        }
+        // C.LWSP / C.LDSP
+        else if (funct3 == 2 || funct3 == 3)
+        {
+            i->inst = (funct3 == 2) ? ENUM_INST_LW : ENUM_INST_LD;
+            i->rs1  = RISCV_REG_SP;
+            i->imm  = (funct3 == 2) ? rvc.lwsp_imm() : rvc.ldsp_imm();
+        }
+        else if (funct3 == 4)
+        {
+            bool rs2_zero = ((opcode >> 2) & 0x1F) == 0;
+
+            // C.JR / C.MV
+            if (!(opcode & (1 << 12)))
+            {
+                i->inst = rs2_zero ? ENUM_INST_JALR : ENUM_INST_ADD;
+                i->rd   = rs2_zero ? 0 : i->rd;
+                i->rs1  = rs2_zero ? i->rs1 : 0;
+                i->imm  = 0;
+            }
+            // C.EBREAK
+            else if (rs2_zero && ((opcode >> 7) & 0x1F) == 0)
+                return false;
+            // C.JALR / C.ADD
+            else
+            {
+                i->inst = rs2_zero ? ENUM_INST_JALR : ENUM_INST_ADD;
+                i->rd   = rs2_zero ? RISCV_REG_RA : i->rd;
+                i->imm  = 0;
+            }
+        }
+        // C.SWSP / C.SDSP
+        else if (funct3 == 6 || funct3 == 7)
+        {
+            i->inst = (funct3 == 6) ? ENUM_INST_SW : ENUM_INST_SD;
+            i->rs1  = RISCV_REG_SP;
+            i->imm  = (funct3 == 6) ? rvc.swsp_imm() : rvc.sdsp_imm();
+        }
+        else
+            return false;
+    }
+    break;
+    default:
+        return false;
+    }
+
+    return true;
+}
+//-----------------------------------------------------------------
+// block_exec: Execute superblock, returns instructions retired
+// (0 if the first instruction must be executed by step()).
+//-----------------------------------------------------------------
+int rv64::block_exec(superblock *b, uint64_t max_insts)
+{
+    static void *ops[BLOCK_OP_MAX];
+    if (!ops[BLOCK_OP_STEP])
+    {
+        for (int k=0;k<BLOCK_OP_MAX;k++)
+            ops[k] = &&op_step;
+
+        ops[ENUM_INST_ANDI]  = &&op_andi;
+        ops[ENUM_INST_ORI]   = &&op_ori;
+        ops[ENUM_INST_XORI]  = &&op_xori;
+        ops[ENUM_INST_ADDI]  = &&op_addi;
+        ops[ENUM_INST_SLTI]  = &&op_slti;
+        ops[ENUM_INST_SLTIU] = &&op_sltiu;
+        ops[ENUM_INST_SLLI]  = &&op_slli;
+        ops[ENUM_INST_SRLI]  = &&op_srli;
+        ops[ENUM_INST_SRAI]  = &&op_srai;
+        ops[ENUM_INST_LUI]   = &&op_lui;
+        ops[ENUM_INST_AUIPC] = &&op_auipc;
+        ops[ENUM_INST_ADD]   = &&op_add;
+        ops[ENUM_INST_SUB]   = &&op_sub;
+        ops[ENUM_INST_SLT]   = &&op_slt;
+        ops[ENUM_INST_SLTU]  = &&op_sltu;
+        ops[ENUM_INST_XOR]   = &&op_xor;
+        ops[ENUM_INST_OR]    = &&op_or;
+        ops[ENUM_INST_AND]   = &&op_and;
+        ops[ENUM_INST_SLL]   = &&op_sll;
+        ops[ENUM_INST_SRL]   = &&op_srl;
+        ops[ENUM_INST_SRA]   = &&op_sra;
+        ops[ENUM_INST_ADDIW] = &&op_addiw;
+        ops[ENUM_INST_ADDW]  = &&op_addw;
+        ops[ENUM_INST_SUBW]  = &&op_subw;
+        ops[ENUM_INST_SLLIW] = &&op_slliw;
+        ops[ENUM_INST_SRLIW] = &&op_srliw;
+        ops[ENUM_INST_SRAIW] = &&op_sraiw;
+        ops[ENUM_INST_SLLW]  = &&op_sllw;
+        ops[ENUM_INST_SRLW]  = &&op_srlw;
+        ops[ENUM_INST_SRAW]  = &&op_sraw;
+        ops[ENUM_INST_MUL]   = &&op_mul;
+        ops[ENUM_INST_DIV]   = &&op_div;
+        ops[ENUM_INST_DIVU]  = &&op_divu;
+        ops[ENUM_INST_REM]   = &&op_rem;
+        ops[ENUM_INST_REMU]  = &&op_remu;
+        ops[ENUM_INST_MULW]  = &&op_mulw;
+        ops[ENUM_INST_DIVW]  = &&op_divw;
+        ops[ENUM_INST_DIVUW] = &&op_divuw;
+        ops[ENUM_INST_REMW]  = &&op_remw;
+        ops[ENUM_INST_REMUW] = &&op_remuw;
+        ops[ENUM_INST_LB]    = &&op_lb;
+        ops[ENUM_INST_LH]    = &&op_lh;
+        ops[ENUM_INST_LW]    = &&op_lw;
+        ops[ENUM_INST_LBU]   = &&op_lbu;
+        ops[ENUM_INST_LHU]   = &&op_lhu;
+        ops[ENUM_INST_LWU]   = &&op_lwu;
+        ops[ENUM_INST_LD]    = &&op_ld;
+        ops[ENUM_INST_SB]    = &&op_sb;
+        ops[ENUM_INST_SH]    = &&op_sh;
+        ops[ENUM_INST_SW]    = &&op_sw;
+        ops[ENUM_INST_SD]    = &&op_sd;
+        ops[ENUM_INST_JAL]   = &&op_jal;
+        ops[ENUM_INST_JALR]  = &&op_jalr;
+        ops[ENUM_INST_BEQ]   = &&op_beq;
+        ops[ENUM_INST_BNE]   = &&op_bne;
+        ops[ENUM_INST_BLT]   = &&op_blt;
+        ops[ENUM_INST_BGE]   = &&op_bge;
+        ops[ENUM_INST_BLTU]  = &&op_bltu;
+        ops[ENUM_INST_BGEU]  = &&op_bgeu;
+        ops[BLOCK_OP_EXIT]   = &&op_exit;
+    }
+
+    if (!b->resolved)
+    {
+        for (int k=0;k<b->count;k++)
+            b->inst[k].op = ops[b->inst[k].inst];
+        b->resolved = true;
+    }
+
+    // Last step before a device deadline, timer match or the budget
+    uint64_t start = m_sched.now;
+    uint64_t next  = m_sched.load_next();
+    uint64_t stop  = next ? (next - 1) : 0;
+    uint64_t timer = timer_event();
+    if (timer >= start && timer < stop)
+        stop = timer;
+    if (max_insts < stop - start)
+        stop = start + max_insts;
+    if (stop <= start)
+        return 0;
+
+    uint64_t   *gpr   = m_gpr;
+    block_inst *i     = b->inst;
+    block_inst *end   = b->inst + ((stop - start) < (uint64_t)b->count ? (stop - start) : b->count);
+    uint64_t    value = 0;
+    uint64_t    taken = 0;
+    int         n;
+
+    // Hot blocks run as host code if the whole block fits before the stop
+    b->execs++;
+    if (b->native && (stop - start) >= (uint64_t)b->count)
+    {
+        typedef int (*native_fn)(uint64_t *gpr, uint64_t *pc, rv64 *cpu, superblock *b);
+
+        m_dbt_start = start;
+        int exit    = ((native_fn)b->native)(gpr, &taken, this, b);
+        i           = b->inst + (exit >> DBT_EXIT_SHIFT);
+
+        m_dbt_runs++;
+        m_dbt_insts += (i - b->inst);
+        switch (exit & DBT_EXIT_MASK)
+        {
+            case DBT_EXIT_FALL:
+            case DBT_EXIT_TAKEN:
+                m_dbt_insts++;
+                if (i->len == 4)
+                    m_stats[STATS_BRANCHES]++;
+                if ((exit & DBT_EXIT_MASK) == DBT_EXIT_TAKEN)
+                    goto exit_taken;
+                goto exit_fall;
+            case DBT_EXIT_BLOCK:
+                goto op_exit;
+            case DBT_EXIT_STEP:
+                goto op_step;
+            case DBT_EXIT_FAULT:
+                goto fault;
+            default:
+                m_dbt_insts++;
+                goto retire;
+        }
+    }
+    else if (b->execs == DBT_HOT && m_dbt_code)
+        dbt_translate(b);
+
+// Dispatch next instruction (or exit before an event is due)
+#define DISPATCH()      do { if (i == end) goto exit_stop; goto *i->op; } while (0)
+#define NEXT()          do { i++; DISPATCH(); } while (0)
+#define RD(v)           do { gpr[i->rd] = (v); gpr[0] = 0; NEXT(); } while (0)
+#define RS1             gpr[i->rs1]
+#define RS2             gpr[i->rs2]
+#define PC              (b->pc + i->offset)
+#define LOAD(w, s)      do { m_sched.store_now(start + (i - b->inst)); m_pc = PC; \
+                             if (!load(m_pc, RS1 + i->imm, &value, w, s)) goto fault; \
+                             gpr[i->rd] = value; gpr[0] = 0; \
+                             if (m_irq_pending || m_poll_period || m_sched.now + 1 >= m_sched.load_next()) goto retire; \
+                             NEXT(); } while (0)
+#define STORE(w)        do { m_sched.store_now(start + (i - b->inst)); m_pc = PC; \
+                             if (!store(m_pc, RS1 + i->imm, RS2, w)) goto fault; \
+                             if (m_irq_pending || m_poll_period || m_sched.now + 1 >= m_sched.load_next() || b->gen != m_block_gen) goto retire; \
+                             NEXT(); } while (0)
+#define BRANCH(c)       do { if (i->len == 4) m_stats[STATS_BRANCHES]++; \
+                             if (c) { taken = PC + i->imm; goto exit_taken; } \
+                             taken = PC + i->len; goto exit_fall; } while (0)
+
+    DISPATCH();
+
+op_andi:    RD(RS1 & i->imm);
+op_ori:     RD(RS1 | i->imm);
+op_xori:    RD(RS1 ^ i->imm);
+op_addi:    RD(RS1 + i->imm);
+op_slti:    RD((int64_t)RS1 < (int64_t)i->imm);
+op_sltiu:   RD((uint64_t)RS1 < (uint64_t)i->imm);
+op_slli:    RD(RS1 << i->imm);
+op_srli:    RD((uint64_t)RS1 >> i->imm);
+op_srai:    RD((int64_t)RS1 >> i->imm);
+op_lui:     RD(i->imm);
+op_auipc:   RD(i->imm + PC);
+op_add:     RD(RS1 + RS2);
+op_sub:     RD(RS1 - RS2);
+op_slt:     RD((int64_t)RS1 < (int64_t)RS2);
+op_sltu:    RD((uint64_t)RS1 < (uint64_t)RS2);
+op_xor:     RD(RS1 ^ RS2);
+op_or:      RD(RS1 | RS2);
+op_and:     RD(RS1 & RS2);
+op_sll:     RD(RS1 << (RS2 & 63));
+op_srl:     RD((uint64_t)RS1 >> (RS2 & 63));
+op_sra:     RD((int64_t)RS1 >> (RS2 & 63));
+op_addiw:   RD(SEXT32(RS1 + i->imm));
+op_addw:    RD(SEXT32(RS1 + RS2));
+op_subw:    RD(SEXT32(RS1 - RS2));
+op_slliw:   RD(SEXT32((RS1 & 0xFFFFFFFF) << i->imm));
+op_srliw:   RD(SEXT32((RS1 & 0xFFFFFFFF) >> i->imm));
+op_sraiw:   RD(SEXT32((int32_t)RS1 >> i->imm));
+op_sllw:    RD(SEXT32(RS1 << (RS2 & SHIFT_MASK32)));
+op_srlw:    RD(SEXT32((RS1 & 0xFFFFFFFF) >> (RS2 & SHIFT_MASK32)));
+op_sraw:    RD(SEXT32((int64_t)RS1 >> (RS2 & SHIFT_MASK32)));
+op_mul:     RD((int64_t)RS1 * (int64_t)RS2);
+op_div:
+    if ((int64_t)RS1 == INT64_MIN && (int64_t)RS2 == -1)
+        RD(RS1);
+    else if (RS2 != 0)
+        RD((int64_t)RS1 / (int64_t)RS2);
+    RD((uint64_t)-1);
+op_divu:
+    if (RS2 != 0)
+        RD((uint64_t)RS1 / (uint64_t)RS2);
+    RD((uint64_t)-1);
+op_rem:
+    if ((int64_t)RS1 == INT64_MIN && (int64_t)RS2 == -1)
+        RD(0);
+    else if (RS2 != 0)
+        RD((int64_t)RS1 % (int64_t)RS2);
+    RD(RS1);
+op_remu:
+    if (RS2 != 0)
+        RD((uint64_t)RS1 % (uint64_t)RS2);
+    RD(RS1);
+op_mulw:    RD(SEXT32((int64_t)RS1 * (int64_t)RS2));
+op_divw:
+    if ((int64_t)(int32_t)RS2 != 0)
+        RD(SEXT32((int64_t)(int32_t)RS1 / (int64_t)(int32_t)RS2));
+    RD((uint64_t)-1);
+op_divuw:
+    if ((uint32_t)RS2 != 0)
+        RD(SEXT32((uint32_t)RS1 / (uint32_t)RS2));
+    RD((uint64_t)-1);
+op_remw:
+    if ((int64_t)(int32_t)RS2 != 0)
+        RD(SEXT32((int64_t)(int32_t)RS1 % (int64_t)(int32_t)RS2));
+    RD(RS1);
+op_remuw:
+    if ((uint32_t)RS2 != 0)
+        RD(SEXT32((uint32_t)RS1 % (uint32_t)RS2));
+    RD(RS1);
+op_lb:      LOAD(1, true);
+op_lh:      LOAD(2, true);
+op_lw:      LOAD(4, true);
+op_lbu:     LOAD(1, false);
+op_lhu:     LOAD(2, false);
+op_lwu:     LOAD(4, false);
+op_ld:      LOAD(8, true);
+op_sb:      STORE(1);
+op_sh:      STORE(2);
+op_sw:      STORE(4);
+op_sd:      STORE(8);
+op_jal:
+    if (i->len == 4)
+        m_stats[STATS_BRANCHES]++;
+    taken = PC + i->imm;
+    gpr[i->rd] = PC + i->len; gpr[0] = 0;
+    goto exit_taken;
+op_jalr:
+    if (i->len == 4)
+        m_stats[STATS_BRANCHES]++;
+    taken = (RS1 + i->imm) & ~1;
+    gpr[i->rd] = PC + i->len; gpr[0] = 0;
+    goto exit_taken;
+op_beq:     BRANCH(RS1 == RS2);
+op_bne:     BRANCH(RS1 != RS2);
+op_blt:     BRANCH((int64_t)RS1 < (int64_t)RS2);
+op_bge:     BRANCH((int64_t)RS1 >= (int64_t)RS2);
+op_bltu:    BRANCH((uint64_t)RS1 < (uint64_t)RS2);
+op_bgeu:    BRANCH((uint64_t)RS1 >= (uint64_t)RS2);
+
+#undef DISPATCH
+#undef NEXT
+#undef RD
+#undef RS1
+#undef RS2
+#undef LOAD
+#undef STORE
+#undef BRANCH
+
+    // Block ended by a jump / branch (retired inline)
+exit_taken:
+    m_block_exit = 1;
+    goto exit_branch;
+exit_fall:
+    m_block_exit = 0;
+exit_branch:
+    n = (i - b->inst) + 1;
+    m_sched.store_now(start + n);
+    m_stats[STATS_INSTRUCTIONS] += n;
+    m_pc                      = taken;
+    m_pc_x                    = PC;
+    return n;
+
+    // Fall through into the next block
+op_exit:
+    m_block_exit = 0;
+    goto exit_pc;
+
+    // Event due before the next instruction
+exit_stop:
+    m_block_exit = -1;
+exit_pc:
+    n = i - b->inst;
+    m_sched.store_now(start + n);
+    m_stats[STATS_INSTRUCTIONS] += n;
+    m_pc                      = PC;
+    if (n)
+        m_pc_x                = b->pc + i[-1].offset;
+    return n;
+
+    // Not handled inline - single step
+op_step:
+    n = i - b->inst;
+    m_sched.store_now(start + n);
+    m_stats[STATS_INSTRUCTIONS] += n;
+    m_pc                      = PC;
+    if (n)
+        m_pc_x                = b->pc + i[-1].offset;
+    step();
+    m_block_exit = 0;
+    return n + 1;
+
+    // Load / store trapped: complete step as execute() would
+fault:
+    n = (i - b->inst) + 1;
+    m_stats[STATS_INSTRUCTIONS] += n;
+    m_block_exit = -1;
+    m_pc_x = PC;
+    execute();
+    step_complete();
+    return n;
+
+    // Load / store may have raised an event: complete step
+retire:
+    n = (i - b->inst) + 1;
+    m_stats[STATS_INSTRUCTIONS] += n;
+    m_block_exit = -1;
+    m_pc_x = PC;
+    m_pc   = PC + i->len;
+    if (m_irq_pending)
+    {
+        for (int irq=IRQ_MIN;irq<IRQ_MAX;irq++)
+        {
+            if (m_irq_pending & (1 << irq))
+            {
+                exception(MCAUSE_INTERRUPT + irq, m_pc);
+                break;
+            }
+        }
+    }
+    step_complete();
+    return n;
+}
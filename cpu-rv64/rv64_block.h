@@ -0,0 +1,39 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#ifndef __RV64_BLOCK_H__
+#define __RV64_BLOCK_H__
+
+#include "rv64_isa.h"
+
+//--------------------------------------------------------------------
+// Superblock pseudo instructions (after the decoded instructions)
+//--------------------------------------------------------------------
+enum eBlockOps
+{
+    BLOCK_OP_STEP = ENUM_INST_MAX, // Execute using step()
+    BLOCK_OP_EXIT,                 // End of block (fall through)
+    BLOCK_OP_MAX
+};
+
+//--------------------------------------------------------------------
+// Translated block exits: (instruction index << DBT_EXIT_SHIFT) | reason
+//--------------------------------------------------------------------
+enum eDbtExit
+{
+    DBT_EXIT_FALL,      // Branch not taken
+    DBT_EXIT_TAKEN,     // Jump / branch taken
+    DBT_EXIT_BLOCK,     // End of block (fall through)
+    DBT_EXIT_STEP,      // Instruction requires step()
+    DBT_EXIT_FAULT,     // Load / store trapped
+    DBT_EXIT_RETIRE     // Load / store may have raised an event
+};
+
+#define DBT_EXIT_SHIFT  8
+#define DBT_EXIT_MASK   ((1 << DBT_EXIT_SHIFT) - 1)
+
+#endif
@@ -0,0 +1,506 @@
+//-----------------------------------------------------------------
+//                        ExactStep IAISS
+//                             V0.5
+//               github.com/ultraembedded/exactstep
+//                     Copyright 2014-2019
+//                    License: BSD 3-Clause
+//-----------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+#include "rv64.h"
+#include "rv64_isa.h"
+#include "rv64_block.h"
+
+//-----------------------------------------------------------------
+// Dynamic binary translation:
+// Hot superblocks are translated to x86-64 code. Guest registers stay
+// in m_gpr, loads / stores call back into load() / store(), and the
+// block exits are handled by block_exec() exactly as for interpreted
+// blocks. A translated block is only entered when all of its
+// instructions can retire before the next event, so no step count
+// checks are required in the generated code.
+//
+// Generated code: int fn(uint64_t *gpr, uint64_t *pc, rv64 *cpu, superblock *b)
+//   rbx = gpr, r12 = pc, r13 = cpu, r14 = b
+//-----------------------------------------------------------------
+#define DBT_MAX_INST_BYTES  96
+
+//-----------------------------------------------------------------
+// enable_dbt: Enable / disable translation (requires superblocks)
+//-----------------------------------------------------------------
+void rv64::enable_dbt(bool en)
+{
+#if defined(__x86_64__)
+    if (en && !m_dbt_code)
+    {
+        void *p = mmap(NULL, DBT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            error(false, "DBT: Cannot map code buffer\n");
+            return ;
+        }
+
+        enable_block_exec(true);
+        block_flush();
+        m_dbt_code = (uint8_t *)p;
+        m_dbt_used = 0;
+    }
+    else if (!en && m_dbt_code)
+    {
+        block_flush();
+        munmap(m_dbt_code, DBT_CODE_SIZE);
+        m_dbt_code = NULL;
+    }
+#else
+    if (en)
+        error(false, "DBT: Not supported on this host\n");
+#endif
+}
+//-----------------------------------------------------------------
+// dbt_stats_reset: Reset translation counters
+//-----------------------------------------------------------------
+void rv64::dbt_stats_reset(void)
+{
+    m_dbt_blocks = 0;
+    m_dbt_runs   = 0;
+    m_dbt_insts  = 0;
+}
+//-----------------------------------------------------------------
+// dbt_stats_dump: Show translation counters (and hottest blocks)
+//-----------------------------------------------------------------
+void rv64::dbt_stats_dump(void)
+{
+    if (!m_dbt_code)
+        return ;
+
+    printf( "- DBT blocks translated %llu, native runs %llu (%llu instructions)\n",
+            (unsigned long long)m_dbt_blocks, (unsigned long long)m_dbt_runs, (unsigned long long)m_dbt_insts);
+
+    // Run counts are not reset with the counters - nothing new to show
+    if (m_dbt_runs == 0)
+        return ;
+
+    // Hottest translated blocks (including those since flushed)
+    const int   top = 8;
+    superblock *hot[top] = { NULL };
+    for (int k=0;k<BLOCK_CACHE_SIZE;k++)
+    {
+        superblock *b = &m_block_cache[k];
+        if (!b->native)
+            continue;
+
+        for (int j=0;j<top;j++)
+        {
+            if (!hot[j] || b->execs > hot[j]->execs)
+            {
+                memmove(&hot[j+1], &hot[j], sizeof(hot[0]) * (top - j - 1));
+                hot[j] = b;
+                break;
+            }
+        }
+    }
+
+    for (int j=0;j<top && hot[j];j++)
+        printf( "  %016llx: %d instructions, %u runs\n",
+                (unsigned long long)hot[j]->pc, hot[j]->count, hot[j]->execs);
+}
+//-----------------------------------------------------------------
+// dbt_mem: Load / store called from translated code.
+// Returns 0 to continue, otherwise the block exit code.
+//-----------------------------------------------------------------
+int rv64::dbt_mem(rv64 *c, superblock *b, int idx)
+{
+    block_inst *i    = &b->inst[idx];
+    uint64_t    addr = c->m_gpr[i->rs1] + i->imm;
+    uint64_t    value = 0;
+    int         ok;
+
+    c->m_sched.store_now(c->m_dbt_start + idx);
+    c->m_pc        = b->pc + i->offset;
+
+    switch (i->inst)
+    {
+        case ENUM_INST_LB:  ok = c->load(c->m_pc, addr, &value, 1, true);  break;
+        case ENUM_INST_LH:  ok = c->load(c->m_pc, addr, &value, 2, true);  break;
+        case ENUM_INST_LW:  ok = c->load(c->m_pc, addr, &value, 4, true);  break;
+        case ENUM_INST_LBU: ok = c->load(c->m_pc, addr, &value, 1, false); break;
+        case ENUM_INST_LHU: ok = c->load(c->m_pc, addr, &value, 2, false); break;
+        case ENUM_INST_LWU: ok = c->load(c->m_pc, addr, &value, 4, false); break;
+        case ENUM_INST_LD:  ok = c->load(c->m_pc, addr, &value, 8, true);  break;
+        case ENUM_INST_SB:  ok = c->store(c->m_pc, addr, c->m_gpr[i->rs2], 1); break;
+        case ENUM_INST_SH:  ok = c->store(c->m_pc, addr, c->m_gpr[i->rs2], 2); break;
+        case ENUM_INST_SW:  ok = c->store(c->m_pc, addr, c->m_gpr[i->rs2], 4); break;
+        default:            ok = c->store(c->m_pc, addr, c->m_gpr[i->rs2], 8); break;
+    }
+
+    if (!ok)
+        return (idx << DBT_EXIT_SHIFT) | DBT_EXIT_FAULT;
+
+    bool is_store = (i->inst >= ENUM_INST_SB && i->inst <= ENUM_INST_SW) || i->inst == ENUM_INST_SD;
+    if (!is_store)
+    {
+        c->m_gpr[i->rd] = value;
+        c->m_gpr[0]     = 0;
+    }
+
+    if (c->m_irq_pending || c->m_poll_period || c->m_sched.now + 1 >= c->m_sched.load_next() || b->gen != c->m_block_gen)
+        return (idx << DBT_EXIT_SHIFT) | DBT_EXIT_RETIRE;
+
+    return 0;
+}
+//-----------------------------------------------------------------
+// dbt_div: Divide / remainder (as per execute)
+//-----------------------------------------------------------------
+uint64_t rv64::dbt_div(uint64_t reg_rs1, uint64_t reg_rs2, int inst)
+{
+    switch (inst)
+    {
+    case ENUM_INST_DIV:
+        if ((int64_t)reg_rs1 == INT64_MIN && (int64_t)reg_rs2 == -1)
+            return reg_rs1;
+        return reg_rs2 ? (int64_t)reg_rs1 / (int64_t)reg_rs2 : (uint64_t)-1;
+    case ENUM_INST_DIVU:
+        return reg_rs2 ? (uint64_t)reg_rs1 / (uint64_t)reg_rs2 : (uint64_t)-1;
+    case ENUM_INST_REM:
+        if ((int64_t)reg_rs1 == INT64_MIN && (int64_t)reg_rs2 == -1)
+            return 0;
+        return reg_rs2 ? (int64_t)reg_rs1 % (int64_t)reg_rs2 : reg_rs1;
+    case ENUM_INST_REMU:
+        return reg_rs2 ? (uint64_t)reg_rs1 % (uint64_t)reg_rs2 : reg_rs1;
+    case ENUM_INST_DIVW:
+        if ((int64_t)(int32_t)reg_rs2 != 0)
+            return SEXT32((int64_t)(int32_t)reg_rs1 / (int64_t)(int32_t)reg_rs2);
+        return (uint64_t)-1;
+    case ENUM_INST_DIVUW:
+        if ((uint32_t)reg_rs2 != 0)
+            return SEXT32((uint32_t)reg_rs1 / (uint32_t)reg_rs2);
+        return (uint64_t)-1;
+    case ENUM_INST_REMW:
+        if ((int64_t)(int32_t)reg_rs2 != 0)
+            return SEXT32((int64_t)(int32_t)reg_rs1 % (int64_t)(int32_t)reg_rs2);
+        return reg_rs1;
+    default: // ENUM_INST_REMUW
+        if ((uint32_t)reg_rs2 != 0)
+            return SEXT32((uint32_t)reg_rs1 % (uint32_t)reg_rs2);
+        return reg_rs1;
+    }
+}
+
+#if defined(__x86_64__)
+//-----------------------------------------------------------------
+// x86-64 code emitter
+//-----------------------------------------------------------------
+class x86_emit
+{
+public:
+    x86_emit(uint8_t *p) { m_p = p; }
+
+    uint8_t *pos(void) { return m_p; }
+
+    void b(int count, ...)
+    {
+        va_list args;
+        va_start(args, count);
+        for (int i=0;i<count;i++)
+            *m_p++ = (uint8_t)va_arg(args, int);
+        va_end(args);
+    }
+    void d32(uint32_t v) { memcpy(m_p, &v, 4); m_p += 4; }
+    void d64(uint64_t v) { memcpy(m_p, &v, 8); m_p += 8; }
+
+    // rax / rcx <- gpr[r], gpr[r] <- rax
+    void load_rax(int r)     { b(3, 0x48, 0x8B, 0x83); d32(r * 8); }
+    void load_rcx(int r)     { b(3, 0x48, 0x8B, 0x8B); d32(r * 8); }
+    void store_rax(int r)    { b(3, 0x48, 0x89, 0x83); d32(r * 8); }
+
+    void mov_rax(uint64_t v) { b(2, 0x48, 0xB8); d64(v); }
+    void mov_eax(uint32_t v) { b(1, 0xB8); d32(v); }
+    void alu_rax_imm(int op, int32_t v) { b(2, 0x48, op); d32(v); }   // op: 05 add, 25 and, 0D or, 35 xor, 3D cmp
+    void alu_rax_rcx(int op) { b(3, 0x48, op, 0xC8); }                // op: 01 add, 29 sub, 21 and, 09 or, 31 xor, 39 cmp
+    void shift_rax_imm(int op, int v) { b(4, 0x48, 0xC1, op, v); }   // op: E0 shl, E8 shr, F8 sar
+    void shift_rax_cl(int op) { b(3, 0x48, 0xD3, op); }
+    void shift_eax_imm(int op, int v) { b(3, 0xC1, op, v); }
+    void shift_eax_cl(int op) { b(2, 0xD3, op); }
+    void sext_eax(void)      { b(3, 0x48, 0x63, 0xC0); }              // movsxd rax, eax
+    void setcc_rax(int cc)   { b(6, 0x0F, cc, 0xC0, 0x0F, 0xB6, 0xC0); } // setcc al; movzx eax, al
+
+    // Call helper (rax = target)
+    void call(const void *fn) { mov_rax((uint64_t)fn); b(2, 0xFF, 0xD0); }
+
+    // *pc = rax; return code
+    void exit(const uint8_t *epilogue, uint32_t code)
+    {
+        b(4, 0x49, 0x89, 0x04, 0x24);
+        mov_eax(code);
+        jmp(epilogue);
+    }
+
+    void jmp(const uint8_t *target) { b(1, 0xE9); d32(target - (m_p + 4)); }
+    uint8_t *jcc(int cc) { b(2, 0x0F, cc); d32(0); return m_p; }
+    void patch(uint8_t *from) { uint32_t rel = m_p - from; memcpy(from - 4, &rel, 4); }
+
+private:
+    uint8_t *m_p;
+};
+
+//-----------------------------------------------------------------
+// dbt_translate: Translate superblock into host code
+//-----------------------------------------------------------------
+bool rv64::dbt_translate(superblock *b)
+{
+    // Not worth entering host code for a single instruction
+    int native = 0;
+    while (native < b->count && b->inst[native].inst < ENUM_INST_MAX)
+        native++;
+    if (native < 2)
+        return false;
+
+    size_t worst = 64 + (size_t)b->count * DBT_MAX_INST_BYTES;
+    if (m_dbt_used + worst > DBT_CODE_SIZE)
+        return false;
+
+    x86_emit e(m_dbt_code + m_dbt_used);
+
+    // Shared epilogue (emitted first so exits jump backwards)
+    uint8_t *epilogue = e.pos();
+    e.b(9, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D, 0xC3);
+
+    // Prologue: save callee saved registers, keep arguments
+    uint8_t *entry = e.pos();
+    e.b(8, 0x55, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56);
+    e.b(12, 0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4, 0x49, 0x89, 0xD5, 0x49, 0x89, 0xCE);
+
+    for (int k=0;k<b->count;k++)
+    {
+        block_inst *i  = &b->inst[k];
+        uint64_t    pc = b->pc + i->offset;
+        int32_t     imm = (int32_t)i->imm;
+        int         rd = i->rd;
+
+        switch (i->inst)
+        {
+        // Immediate ALU
+        case ENUM_INST_ADDI:
+        case ENUM_INST_ANDI:
+        case ENUM_INST_ORI:
+        case ENUM_INST_XORI:
+        case ENUM_INST_ADDIW:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            if (i->inst == ENUM_INST_ADDIW)
+            {
+                e.b(1, 0x05); e.d32(imm);
+                e.sext_eax();
+            }
+            else
+                e.alu_rax_imm(i->inst == ENUM_INST_ADDI ? 0x05 : i->inst == ENUM_INST_ANDI ? 0x25 :
+                              i->inst == ENUM_INST_ORI  ? 0x0D : 0x35, imm);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SLTI:
+        case ENUM_INST_SLTIU:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.alu_rax_imm(0x3D, imm);
+            e.setcc_rax(i->inst == ENUM_INST_SLTI ? 0x9C : 0x92);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SLLI:
+        case ENUM_INST_SRLI:
+        case ENUM_INST_SRAI:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.shift_rax_imm(i->inst == ENUM_INST_SLLI ? 0xE0 : i->inst == ENUM_INST_SRLI ? 0xE8 : 0xF8, imm & 63);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SLLIW:
+        case ENUM_INST_SRLIW:
+        case ENUM_INST_SRAIW:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.shift_eax_imm(i->inst == ENUM_INST_SLLIW ? 0xE0 : i->inst == ENUM_INST_SRLIW ? 0xE8 : 0xF8, imm & 31);
+            e.sext_eax();
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_LUI:
+            if (!rd) break;
+            e.mov_rax((uint64_t)i->imm);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_AUIPC:
+            if (!rd) break;
+            e.mov_rax(pc + i->imm);
+            e.store_rax(rd);
+            break;
+        // Register ALU
+        case ENUM_INST_ADD:
+        case ENUM_INST_SUB:
+        case ENUM_INST_AND:
+        case ENUM_INST_OR:
+        case ENUM_INST_XOR:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.alu_rax_rcx(i->inst == ENUM_INST_ADD ? 0x01 : i->inst == ENUM_INST_SUB ? 0x29 :
+                          i->inst == ENUM_INST_AND ? 0x21 : i->inst == ENUM_INST_OR  ? 0x09 : 0x31);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SLT:
+        case ENUM_INST_SLTU:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.alu_rax_rcx(0x39);
+            e.setcc_rax(i->inst == ENUM_INST_SLT ? 0x9C : 0x92);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SLL:
+        case ENUM_INST_SRL:
+        case ENUM_INST_SRA:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.shift_rax_cl(i->inst == ENUM_INST_SLL ? 0xE0 : i->inst == ENUM_INST_SRL ? 0xE8 : 0xF8);
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_ADDW:
+        case ENUM_INST_SUBW:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.b(2, i->inst == ENUM_INST_ADDW ? 0x01 : 0x29, 0xC8);
+            e.sext_eax();
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SLLW:
+        case ENUM_INST_SRLW:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.shift_eax_cl(i->inst == ENUM_INST_SLLW ? 0xE0 : 0xE8);
+            e.sext_eax();
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_SRAW:
+            // As execute: 64-bit source shifted by rs2[4:0]
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.b(3, 0x83, 0xE1, 0x1F);
+            e.shift_rax_cl(0xF8);
+            e.sext_eax();
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_MUL:
+        case ENUM_INST_MULW:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            if (i->inst == ENUM_INST_MUL)
+                e.b(4, 0x48, 0x0F, 0xAF, 0xC1);
+            else
+            {
+                e.b(3, 0x0F, 0xAF, 0xC1);
+                e.sext_eax();
+            }
+            e.store_rax(rd);
+            break;
+        case ENUM_INST_DIV:
+        case ENUM_INST_DIVU:
+        case ENUM_INST_REM:
+        case ENUM_INST_REMU:
+        case ENUM_INST_DIVW:
+        case ENUM_INST_DIVUW:
+        case ENUM_INST_REMW:
+        case ENUM_INST_REMUW:
+            if (!rd) break;
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.b(6, 0x48, 0x89, 0xC7, 0x48, 0x89, 0xCE);    // rdi = rax, rsi = rcx
+            e.b(1, 0xBA); e.d32(i->inst);                   // edx = inst
+            e.call((const void *)&rv64::dbt_div);
+            e.store_rax(rd);
+            break;
+        // Loads / stores (exit on fault or event)
+        case ENUM_INST_LB:
+        case ENUM_INST_LH:
+        case ENUM_INST_LW:
+        case ENUM_INST_LBU:
+        case ENUM_INST_LHU:
+        case ENUM_INST_LWU:
+        case ENUM_INST_LD:
+        case ENUM_INST_SB:
+        case ENUM_INST_SH:
+        case ENUM_INST_SW:
+        case ENUM_INST_SD:
+            e.b(6, 0x4C, 0x89, 0xEF, 0x4C, 0x89, 0xF6);    // rdi = cpu, rsi = b
+            e.b(1, 0xBA); e.d32(k);                         // edx = idx
+            e.call((const void *)&rv64::dbt_mem);
+            e.b(2, 0x85, 0xC0);                             // test eax, eax
+            e.b(2, 0x0F, 0x85); e.d32(epilogue - (e.pos() + 4));
+            break;
+        // Block terminators
+        case ENUM_INST_JAL:
+            if (rd)
+            {
+                e.mov_rax(pc + i->len);
+                e.store_rax(rd);
+            }
+            e.mov_rax(pc + i->imm);
+            e.exit(epilogue, (k << DBT_EXIT_SHIFT) | DBT_EXIT_TAKEN);
+            break;
+        case ENUM_INST_JALR:
+            e.load_rax(i->rs1);
+            e.alu_rax_imm(0x05, imm);
+            e.b(4, 0x48, 0x83, 0xE0, 0xFE);                 // and rax, ~1
+            e.b(4, 0x49, 0x89, 0x04, 0x24);                 // *pc = rax
+            if (rd)
+            {
+                e.mov_rax(pc + i->len);
+                e.store_rax(rd);
+            }
+            e.mov_eax((k << DBT_EXIT_SHIFT) | DBT_EXIT_TAKEN);
+            e.jmp(epilogue);
+            break;
+        case ENUM_INST_BEQ:
+        case ENUM_INST_BNE:
+        case ENUM_INST_BLT:
+        case ENUM_INST_BGE:
+        case ENUM_INST_BLTU:
+        case ENUM_INST_BGEU:
+        {
+            static const uint8_t cc[] = { 0x84, 0x85, 0x8C, 0x8D, 0x82, 0x83 };
+            e.load_rax(i->rs1);
+            e.load_rcx(i->rs2);
+            e.alu_rax_rcx(0x39);
+            uint8_t *taken = e.jcc(cc[i->inst - ENUM_INST_BEQ]);
+            e.mov_rax(pc + i->len);
+            e.exit(epilogue, (k << DBT_EXIT_SHIFT) | DBT_EXIT_FALL);
+            e.patch(taken);
+            e.mov_rax(pc + i->imm);
+            e.exit(epilogue, (k << DBT_EXIT_SHIFT) | DBT_EXIT_TAKEN);
+        }
+        break;
+        case BLOCK_OP_EXIT:
+            e.mov_eax((k << DBT_EXIT_SHIFT) | DBT_EXIT_BLOCK);
+            e.jmp(epilogue);
+            break;
+        default:
+            e.mov_eax((k << DBT_EXIT_SHIFT) | DBT_EXIT_STEP);
+            e.jmp(epilogue);
+            break;
+        }
+    }
+
+    m_dbt_used = e.pos() - m_dbt_code;
+    b->native  = entry;
+    m_dbt_blocks++;
+    return true;
+}
+#else
+bool rv64::dbt_translate(superblock *b) { return false; }
+#endif
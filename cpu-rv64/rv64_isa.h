@@ -8,6 +8,8 @@
 #ifndef __RV64_ISA_H__
 #define __RV64_ISA_H__
 
+#include "decode_table.h"
+
 //-----------------------------------------------------------------
 // General:
 //-----------------------------------------------------------------
@@ -160,6 +162,36 @@ enum eInstructions
     ENUM_INST_DIVW,
     ENUM_INST_REMUW,
     ENUM_INST_REMW,
+    // A extension
+    ENUM_INST_AMOADD_W,
+    ENUM_INST_AMOXOR_W,
+    ENUM_INST_AMOOR_W,
+    ENUM_INST_AMOAND_W,
+    ENUM_INST_AMOMIN_W,
+    ENUM_INST_AMOMAX_W,
+    ENUM_INST_AMOMINU_W,
+    ENUM_INST_AMOMAXU_W,
+    ENUM_INST_AMOSWAP_W,
+    ENUM_INST_LR_W,
+    ENUM_INST_SC_W,
+    ENUM_INST_AMOADD_D,
+    ENUM_INST_AMOXOR_D,
+    ENUM_INST_AMOOR_D,
+    ENUM_INST_AMOAND_D,
+    ENUM_INST_AMOMIN_D,
+    ENUM_INST_AMOMAX_D,
+    ENUM_INST_AMOMINU_D,
+    ENUM_INST_AMOMAXU_D,
+    ENUM_INST_AMOSWAP_D,
+    ENUM_INST_LR_D,
+    ENUM_INST_SC_D,
+    // C extension (decoded per quadrant)
+    ENUM_INST_RVC_Q0,
+    ENUM_INST_RVC_Q1_LO,
+    ENUM_INST_RVC_Q1_HI,
+    ENUM_INST_RVC_Q2,
+    // All zero opcode
+    ENUM_INST_BAD,
 
     ENUM_INST_MAX
 };
@@ -240,6 +272,33 @@ static const char * inst_names[ENUM_INST_MAX+1] =
     [ENUM_INST_DIVW] = "divw",
     [ENUM_INST_REMUW] = "remuw",
     [ENUM_INST_REMW] = "remw",
+    [ENUM_INST_AMOADD_W] = "amoadd.w",
+    [ENUM_INST_AMOXOR_W] = "amoxor.w",
+    [ENUM_INST_AMOOR_W] = "amoor.w",
+    [ENUM_INST_AMOAND_W] = "amoand.w",
+    [ENUM_INST_AMOMIN_W] = "amomin.w",
+    [ENUM_INST_AMOMAX_W] = "amomax.w",
+    [ENUM_INST_AMOMINU_W] = "amominu.w",
+    [ENUM_INST_AMOMAXU_W] = "amomaxu.w",
+    [ENUM_INST_AMOSWAP_W] = "amoswap.w",
+    [ENUM_INST_LR_W] = "lr.w",
+    [ENUM_INST_SC_W] = "sc.w",
+    [ENUM_INST_AMOADD_D] = "amoadd.d",
+    [ENUM_INST_AMOXOR_D] = "amoxor.d",
+    [ENUM_INST_AMOOR_D] = "amoor.d",
+    [ENUM_INST_AMOAND_D] = "amoand.d",
+    [ENUM_INST_AMOMIN_D] = "amomin.d",
+    [ENUM_INST_AMOMAX_D] = "amomax.d",
+    [ENUM_INST_AMOMINU_D] = "amominu.d",
+    [ENUM_INST_AMOMAXU_D] = "amomaxu.d",
+    [ENUM_INST_AMOSWAP_D] = "amoswap.d",
+    [ENUM_INST_LR_D] = "lr.d",
+    [ENUM_INST_SC_D] = "sc.d",
+    [ENUM_INST_RVC_Q0] = "c.q0",
+    [ENUM_INST_RVC_Q1_LO] = "c.q1",
+    [ENUM_INST_RVC_Q1_HI] = "c.q1",
+    [ENUM_INST_RVC_Q2] = "c.q2",
+    [ENUM_INST_BAD] = "bad",
     [ENUM_INST_MAX] = ""
 };
 
@@ -604,6 +663,123 @@ static const char * inst_names[ENUM_INST_MAX+1] =
 #define INST_SC_D 0x1800302f
 #define INST_SC_D_MASK  0xf800707f
 
+//--------------------------------------------------------------------
+// Decode table (ordered, first match wins)
+//--------------------------------------------------------------------
+#define DECODE_RVM          (1 << 0)
+#define DECODE_RVA          (1 << 1)
+#define DECODE_RVC          (1 << 2)
+
+static constexpr decode_desc rv64_decode_desc[] =
+{
+    { 0xFFFFFFFF,           0,               ENUM_INST_BAD,        0 },
+    { INST_ANDI_MASK,       INST_ANDI,       ENUM_INST_ANDI,       0 },
+    { INST_ORI_MASK,        INST_ORI,        ENUM_INST_ORI,        0 },
+    { INST_XORI_MASK,       INST_XORI,       ENUM_INST_XORI,       0 },
+    { INST_ADDI_MASK,       INST_ADDI,       ENUM_INST_ADDI,       0 },
+    { INST_SLTI_MASK,       INST_SLTI,       ENUM_INST_SLTI,       0 },
+    { INST_SLTIU_MASK,      INST_SLTIU,      ENUM_INST_SLTIU,      0 },
+    { INST_SLLI_MASK,       INST_SLLI,       ENUM_INST_SLLI,       0 },
+    { INST_SRLI_MASK,       INST_SRLI,       ENUM_INST_SRLI,       0 },
+    { INST_SRAI_MASK,       INST_SRAI,       ENUM_INST_SRAI,       0 },
+    { INST_LUI_MASK,        INST_LUI,        ENUM_INST_LUI,        0 },
+    { INST_AUIPC_MASK,      INST_AUIPC,      ENUM_INST_AUIPC,      0 },
+    { INST_ADD_MASK,        INST_ADD,        ENUM_INST_ADD,        0 },
+    { INST_SUB_MASK,        INST_SUB,        ENUM_INST_SUB,        0 },
+    { INST_SLT_MASK,        INST_SLT,        ENUM_INST_SLT,        0 },
+    { INST_SLTU_MASK,       INST_SLTU,       ENUM_INST_SLTU,       0 },
+    { INST_XOR_MASK,        INST_XOR,        ENUM_INST_XOR,        0 },
+    { INST_OR_MASK,         INST_OR,         ENUM_INST_OR,         0 },
+    { INST_AND_MASK,        INST_AND,        ENUM_INST_AND,        0 },
+    { INST_SLL_MASK,        INST_SLL,        ENUM_INST_SLL,        0 },
+    { INST_SRL_MASK,        INST_SRL,        ENUM_INST_SRL,        0 },
+    { INST_SRA_MASK,        INST_SRA,        ENUM_INST_SRA,        0 },
+    { INST_JAL_MASK,        INST_JAL,        ENUM_INST_JAL,        0 },
+    { INST_JALR_MASK,       INST_JALR,       ENUM_INST_JALR,       0 },
+    { INST_BEQ_MASK,        INST_BEQ,        ENUM_INST_BEQ,        0 },
+    { INST_BNE_MASK,        INST_BNE,        ENUM_INST_BNE,        0 },
+    { INST_BLT_MASK,        INST_BLT,        ENUM_INST_BLT,        0 },
+    { INST_BGE_MASK,        INST_BGE,        ENUM_INST_BGE,        0 },
+    { INST_BLTU_MASK,       INST_BLTU,       ENUM_INST_BLTU,       0 },
+    { INST_BGEU_MASK,       INST_BGEU,       ENUM_INST_BGEU,       0 },
+    { INST_LB_MASK,         INST_LB,         ENUM_INST_LB,         0 },
+    { INST_LH_MASK,         INST_LH,         ENUM_INST_LH,         0 },
+    { INST_LW_MASK,         INST_LW,         ENUM_INST_LW,         0 },
+    { INST_LBU_MASK,        INST_LBU,        ENUM_INST_LBU,        0 },
+    { INST_LHU_MASK,        INST_LHU,        ENUM_INST_LHU,        0 },
+    { INST_LWU_MASK,        INST_LWU,        ENUM_INST_LWU,        0 },
+    { INST_SB_MASK,         INST_SB,         ENUM_INST_SB,         0 },
+    { INST_SH_MASK,         INST_SH,         ENUM_INST_SH,         0 },
+    { INST_SW_MASK,         INST_SW,         ENUM_INST_SW,         0 },
+    { INST_MUL_MASK,        INST_MUL,        ENUM_INST_MUL,        DECODE_RVM },
+    { INST_MULH_MASK,       INST_MULH,       ENUM_INST_MULH,       DECODE_RVM },
+    { INST_MULHSU_MASK,     INST_MULHSU,     ENUM_INST_MULHSU,     DECODE_RVM },
+    { INST_MULHU_MASK,      INST_MULHU,      ENUM_INST_MULHU,      DECODE_RVM },
+    { INST_DIV_MASK,        INST_DIV,        ENUM_INST_DIV,        DECODE_RVM },
+    { INST_DIVU_MASK,       INST_DIVU,       ENUM_INST_DIVU,       DECODE_RVM },
+    { INST_REM_MASK,        INST_REM,        ENUM_INST_REM,        DECODE_RVM },
+    { INST_REMU_MASK,       INST_REMU,       ENUM_INST_REMU,       DECODE_RVM },
+    { INST_ECALL_MASK,      INST_ECALL,      ENUM_INST_ECALL,      0 },
+    { INST_EBREAK_MASK,     INST_EBREAK,     ENUM_INST_EBREAK,     0 },
+    { INST_MRET_MASK,       INST_MRET,       ENUM_INST_MRET,       0 },
+    { INST_SRET_MASK,       INST_SRET,       ENUM_INST_SRET,       0 },
+    { INST_SFENCE_MASK,     INST_SFENCE,     ENUM_INST_FENCE,      0 },
+    { INST_FENCE_MASK,      INST_FENCE,      ENUM_INST_FENCE,      0 },
+    { INST_IFENCE_MASK,     INST_IFENCE,     ENUM_INST_FENCE,      0 },
+    { INST_CSRRW_MASK,      INST_CSRRW,      ENUM_INST_CSRRW,      0 },
+    { INST_CSRRS_MASK,      INST_CSRRS,      ENUM_INST_CSRRS,      0 },
+    { INST_CSRRC_MASK,      INST_CSRRC,      ENUM_INST_CSRRC,      0 },
+    { INST_CSRRWI_MASK,     INST_CSRRWI,     ENUM_INST_CSRRWI,     0 },
+    { INST_CSRRSI_MASK,     INST_CSRRSI,     ENUM_INST_CSRRSI,     0 },
+    { INST_CSRRCI_MASK,     INST_CSRRCI,     ENUM_INST_CSRRCI,     0 },
+    { INST_WFI_MASK,        INST_WFI,        ENUM_INST_WFI,        0 },
+    { INST_SD_MASK,         INST_SD,         ENUM_INST_SD,         0 },
+    { INST_LD_MASK,         INST_LD,         ENUM_INST_LD,         0 },
+    { INST_ADDIW_MASK,      INST_ADDIW,      ENUM_INST_ADDIW,      0 },
+    { INST_ADDW_MASK,       INST_ADDW,       ENUM_INST_ADDW,       0 },
+    { INST_SUBW_MASK,       INST_SUBW,       ENUM_INST_SUBW,       0 },
+    { INST_SLLIW_MASK,      INST_SLLIW,      ENUM_INST_SLLIW,      0 },
+    { INST_SRLIW_MASK,      INST_SRLIW,      ENUM_INST_SRLIW,      0 },
+    { INST_SRAIW_MASK,      INST_SRAIW,      ENUM_INST_SRAIW,      0 },
+    { INST_SLLW_MASK,       INST_SLLW,       ENUM_INST_SLLW,       0 },
+    { INST_SRLW_MASK,       INST_SRLW,       ENUM_INST_SRLW,       0 },
+    { INST_SRAW_MASK,       INST_SRAW,       ENUM_INST_SRAW,       0 },
+    { INST_MULW_MASK,       INST_MULW,       ENUM_INST_MULW,       DECODE_RVM },
+    { INST_DIVW_MASK,       INST_DIVW,       ENUM_INST_DIVW,       DECODE_RVM },
+    { INST_DIVUW_MASK,      INST_DIVUW,      ENUM_INST_DIVUW,      DECODE_RVM },
+    { INST_REMW_MASK,       INST_REMW,       ENUM_INST_REMW,       DECODE_RVM },
+    { INST_REMUW_MASK,      INST_REMUW,      ENUM_INST_REMUW,      DECODE_RVM },
+    { INST_AMOADD_W_MASK,   INST_AMOADD_W,   ENUM_INST_AMOADD_W,   DECODE_RVA },
+    { INST_AMOXOR_W_MASK,   INST_AMOXOR_W,   ENUM_INST_AMOXOR_W,   DECODE_RVA },
+    { INST_AMOOR_W_MASK,    INST_AMOOR_W,    ENUM_INST_AMOOR_W,    DECODE_RVA },
+    { INST_AMOAND_W_MASK,   INST_AMOAND_W,   ENUM_INST_AMOAND_W,   DECODE_RVA },
+    { INST_AMOMIN_W_MASK,   INST_AMOMIN_W,   ENUM_INST_AMOMIN_W,   DECODE_RVA },
+    { INST_AMOMAX_W_MASK,   INST_AMOMAX_W,   ENUM_INST_AMOMAX_W,   DECODE_RVA },
+    { INST_AMOMINU_W_MASK,  INST_AMOMINU_W,  ENUM_INST_AMOMINU_W,  DECODE_RVA },
+    { INST_AMOMAXU_W_MASK,  INST_AMOMAXU_W,  ENUM_INST_AMOMAXU_W,  DECODE_RVA },
+    { INST_AMOSWAP_W_MASK,  INST_AMOSWAP_W,  ENUM_INST_AMOSWAP_W,  DECODE_RVA },
+    { INST_LR_W_MASK,       INST_LR_W,       ENUM_INST_LR_W,       DECODE_RVA },
+    { INST_SC_W_MASK,       INST_SC_W,       ENUM_INST_SC_W,       DECODE_RVA },
+    { INST_AMOADD_D_MASK,   INST_AMOADD_D,   ENUM_INST_AMOADD_D,   DECODE_RVA },
+    { INST_AMOXOR_D_MASK,   INST_AMOXOR_D,   ENUM_INST_AMOXOR_D,   DECODE_RVA },
+    { INST_AMOOR_D_MASK,    INST_AMOOR_D,    ENUM_INST_AMOOR_D,    DECODE_RVA },
+    { INST_AMOAND_D_MASK,   INST_AMOAND_D,   ENUM_INST_AMOAND_D,   DECODE_RVA },
+    { INST_AMOMIN_D_MASK,   INST_AMOMIN_D,   ENUM_INST_AMOMIN_D,   DECODE_RVA },
+    { INST_AMOMAX_D_MASK,   INST_AMOMAX_D,   ENUM_INST_AMOMAX_D,   DECODE_RVA },
+    { INST_AMOMINU_D_MASK,  INST_AMOMINU_D,  ENUM_INST_AMOMINU_D,  DECODE_RVA },
+    { INST_AMOMAXU_D_MASK,  INST_AMOMAXU_D,  ENUM_INST_AMOMAXU_D,  DECODE_RVA },
+    { INST_AMOSWAP_D_MASK,  INST_AMOSWAP_D,  ENUM_INST_AMOSWAP_D,  DECODE_RVA },
+    { INST_LR_D_MASK,       INST_LR_D,       ENUM_INST_LR_D,       DECODE_RVA },
+    { INST_SC_D_MASK,       INST_SC_D,       ENUM_INST_SC_D,       DECODE_RVA },
+    { 0x3,                  0x0,             ENUM_INST_RVC_Q0,     DECODE_RVC },
+    { 0x8003,               0x1,             ENUM_INST_RVC_Q1_LO,  DECODE_RVC },
+    { 0x3,                  0x1,             ENUM_INST_RVC_Q1_HI,  DECODE_RVC },
+    { 0x3,                  0x2,             ENUM_INST_RVC_Q2,     DECODE_RVC },
+};
+
+// Two level (major opcode, funct3) lookup table built from the above
+static constexpr int rv64_decode_size = decode_table_size(rv64_decode_desc);
+static constexpr decode_table<rv64_decode_size> rv64_decode = decode_table_build<rv64_decode_size>(rv64_decode_desc);
 
 //--------------------------------------------------------------------
 // Privilege levels
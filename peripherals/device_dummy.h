@@ -35,7 +35,7 @@ public:
 
     int clock(void)
     {
-        return 0;
+        return DEVICE_CLOCK_IDLE;
     }
 
 private:
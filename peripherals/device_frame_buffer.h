@@ -11,6 +11,11 @@
 #include "device.h"
 #include "display.h"
 
+//-----------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------
+#define FB_REFRESH_INTERVAL     100000  // Steps between display updates
+
 //-----------------------------------------------------------------
 // device_frame_buffer: Simplified frame buffer device
 //-----------------------------------------------------------------
@@ -20,7 +25,7 @@ public:
     device_frame_buffer(uint32_t base_addr, int width, int height): device("fb", base_addr, height * width * 2, NULL, -1)
     {
         m_fb      = new uint8_t[height * width * 2];
-        m_ticks   = 0;
+        m_refresh = FB_REFRESH_INTERVAL;
 
         m_display.init(width, height);
     }
@@ -64,17 +69,18 @@ public:
 
     int clock(void)
     {
-        if (++m_ticks == 100000)
+        uint64_t now = clock_now();
+        if (now >= m_refresh)
         {
             m_display.update(m_fb);
-            m_ticks   = 0;
+            m_refresh = now + FB_REFRESH_INTERVAL;
         }
-        return 0;
+        return (int)(m_refresh - now);
     }
 
 private:
     uint8_t *m_fb;
-    int      m_ticks;
+    uint64_t m_refresh;
     display  m_display;
 };
 
@@ -8,7 +8,9 @@
 #ifndef __DEVICE_IRQ_PLIC_H__
 #define __DEVICE_IRQ_PLIC_H__
 
+#include <vector>
 #include "device.h"
+#include "cpu.h"
 
 //-----------------------------------------------------------------
 // Defines
@@ -19,63 +21,78 @@
 #define PLIC_REG_PENDING3            0x100c
 #define PLIC_REG_ENABLE0             0x2000
 #define PLIC_REG_ENABLE3             0x200c
-#define PLIC_ENABLE_PER_HART         0x80
+#define PLIC_ENABLE_PER_CTX          0x80
 #define PLIC_REG_PRIO_THRESH         0x00200000
 #define PLIC_REG_CLAIM               0x00200004
-#define PLIC_CONTEXT_PER_HART        0x1000
+#define PLIC_CONTEXT_PER_CTX         0x1000
 
 #define PLIC_NUM_IRQS                128
 #define PLIC_REG_SIZE                (0x10000000 - 0x0c000000)
 #define PLIC_IRQ_GROUPS              4
+#define PLIC_MAX_HARTS               (15872 / 2)
 
 //-----------------------------------------------------------------
 // device_irq_plic: 'Platform Interrupt Controller' model
+// Each hart has an M (2n) and S (2n+1) context, which alias in this
+// implementation.
 //-----------------------------------------------------------------
 class device_irq_plic: public device
 {
 public:
     device_irq_plic(uint32_t base_addr, int irq): device("plic", base_addr, PLIC_REG_SIZE, NULL, irq)
     {
+        m_harts.resize(1);
+        m_harts[0].hart = NULL;
         reset();
     }
-    
+
+    // Additional harts (hart 0 is signalled via the owning CPU's device events)
+    void attach_hart(int hartid, cpu *hart)
+    {
+        if (hartid >= PLIC_MAX_HARTS)
+            return ;
+        if (hartid >= (int)m_harts.size())
+            m_harts.resize(hartid + 1);
+
+        m_harts[hartid].hart = hart;
+        reset_hart(hartid);
+    }
+
     void reset(void)
     {
         for (int x=0;x<PLIC_IRQ_GROUPS;x++)
-        {
             m_pending[x] = 0;
-            m_enable[x]  = 0;
-        }
         for (int i=0;i<PLIC_NUM_IRQS;i++)
             m_prio[i] = 0;
 
-        m_prio_thresh = 0;
-        m_irq = false;
+        for (size_t h=0;h<m_harts.size();h++)
+            reset_hart(h);
     }
 
-    int eval_irq(void)
+    int eval_irq(int hart)
     {
+        plic_hart &ctx = m_harts[hart];
         uint32_t masked[PLIC_IRQ_GROUPS];
 
         for (int x=0;x<PLIC_IRQ_GROUPS;x++)
-            masked[x] = m_pending[x] & m_enable[x];
+            masked[x] = m_pending[x] & ctx.enable[x];
 
         // Mask interrupts less than or equal to threshold
         for (int i=0;i<PLIC_NUM_IRQS;i++)
-            if (m_prio[i] <= m_prio_thresh)
+            if (m_prio[i] <= ctx.prio_thresh)
             {
                 int grp = i / 32;
                 int bit = i % 32;
                 masked[grp] &= ~(1  << bit);
             }
 
-        m_irq = false;
+        ctx.irq = false;
         for (int x=0;x<PLIC_IRQ_GROUPS;x++)
             for (int i=0;i<32;i++)
                 if (masked[x] & (1 << i))
                 {
-                    raise_interrupt();
-                    m_irq = true;
+                    signal_irq(hart, true);
+                    ctx.irq = true;
                     return (x*32) + i;
                 }
 
@@ -95,24 +112,25 @@ public:
         // Interrupt 0 is hard-wired to zero
         m_pending[0] &= ~(1 << 0);
 
-        eval_irq();
+        for (size_t h=0;h<m_harts.size();h++)
+            eval_irq(h);
     }
 
     bool write32(uint32_t address, uint32_t data)
     {
         address -= m_base;
 
+        int hart = -1; // All
+        int idx;
+
         if (address >= PLIC_REG_SRC_PRIO0 && address <= PLIC_REG_SRC_PRIO127)
             m_prio[(address-PLIC_REG_SRC_PRIO0)/4] = data;
-        else if (address >= PLIC_REG_ENABLE0 && address <= PLIC_REG_ENABLE3)
-            m_enable[(address-PLIC_REG_ENABLE0)/4] = data;
-        // Context 1 (S) aliases to context 0 (M) in this implementation
-        else if (address >= (PLIC_REG_ENABLE0 + PLIC_ENABLE_PER_HART) && address <= (PLIC_REG_ENABLE3 + PLIC_ENABLE_PER_HART))
-            m_enable[(address-PLIC_REG_ENABLE0-PLIC_ENABLE_PER_HART)/4] = data;
-        else if ((address == PLIC_REG_PRIO_THRESH) || (address == PLIC_REG_PRIO_THRESH + PLIC_CONTEXT_PER_HART))
-            m_prio_thresh = data;
+        else if (enable_reg(address, &hart, &idx))
+            m_harts[hart].enable[idx] = data;
+        else if (context_reg(address, PLIC_REG_PRIO_THRESH, &hart))
+            m_harts[hart].prio_thresh = data;
         // Complete interrupt
-        else if ((address == PLIC_REG_CLAIM) || (address == (PLIC_REG_CLAIM + PLIC_CONTEXT_PER_HART)))
+        else if (context_reg(address, PLIC_REG_CLAIM, &hart))
         {
             // Interrupt claimed - clear
             if (data > 0)
@@ -123,13 +141,17 @@ public:
             }
 
             // Drop interrupt if nothing new pending
-            if (eval_irq() == 0)
-                drop_interrupt();
+            if (eval_irq(hart) == 0)
+                signal_irq(hart, false);
         }
         else
             fprintf(stderr, "PLIC: Bad write @ %08x\n", address);
 
-        eval_irq();
+        if (hart != -1)
+            eval_irq(hart);
+        else
+            for (size_t h=0;h<m_harts.size();h++)
+                eval_irq(h);
         return true;
     }
 
@@ -138,6 +160,7 @@ public:
         data = 0;
         address -= m_base;
 
+        int hart, idx;
         if (address >= PLIC_REG_SRC_PRIO0 && address <= PLIC_REG_SRC_PRIO127)
         {
             data = m_prio[(address-PLIC_REG_SRC_PRIO0)/4];
@@ -148,25 +171,19 @@ public:
             data = m_pending[(address-PLIC_REG_PENDING0)/4];
             return true;
         }
-        else if (address >= PLIC_REG_ENABLE0 && address <= PLIC_REG_ENABLE3)
+        else if (enable_reg(address, &hart, &idx))
         {
-            data = m_enable[(address-PLIC_REG_ENABLE0)/4];
+            data = m_harts[hart].enable[idx];
             return true;
         }
-        // Context 1 (S) aliases to context 0 (M) in this implementation
-        else if (address >= (PLIC_REG_ENABLE0 + PLIC_ENABLE_PER_HART) && address <= (PLIC_REG_ENABLE3 + PLIC_ENABLE_PER_HART))
+        else if (context_reg(address, PLIC_REG_PRIO_THRESH, &hart))
         {
-            data = m_enable[(address-PLIC_REG_ENABLE0 - PLIC_ENABLE_PER_HART)/4];
+            data = m_harts[hart].prio_thresh;
             return true;
         }
-        else if ((address == PLIC_REG_PRIO_THRESH) || (address == PLIC_REG_PRIO_THRESH + PLIC_CONTEXT_PER_HART))
+        else if (context_reg(address, PLIC_REG_CLAIM, &hart))
         {
-            data = m_prio_thresh;
-            return true;
-        }
-        else if ((address == PLIC_REG_CLAIM) || (address == (PLIC_REG_CLAIM + PLIC_CONTEXT_PER_HART)))
-        {
-            int irq = eval_irq();
+            int irq = eval_irq(hart);
             data = (uint32_t)irq;
             return true;
         }
@@ -177,15 +194,73 @@ public:
 
     int clock(void)
     {
-        return 0;
+        return DEVICE_CLOCK_IDLE;
     }
 
 private:
+    void reset_hart(int hart)
+    {
+        for (int x=0;x<PLIC_IRQ_GROUPS;x++)
+            m_harts[hart].enable[x] = 0;
+        m_harts[hart].prio_thresh = 0;
+        m_harts[hart].irq         = false;
+    }
+
+    // Hart 0 uses device interrupt events, others are posted to their thread
+    void signal_irq(int hart, bool raise)
+    {
+        if (hart == 0)
+        {
+            if (raise)
+                raise_interrupt();
+            else
+                drop_interrupt();
+        }
+        else if (m_harts[hart].hart)
+            m_harts[hart].hart->post_interrupt(m_irq_number, raise);
+    }
+
+    // Enable word for context (M/S) of a hart
+    bool enable_reg(uint32_t address, int *hart, int *idx)
+    {
+        if (address < PLIC_REG_ENABLE0)
+            return false;
+
+        uint32_t ctx = (address - PLIC_REG_ENABLE0) / PLIC_ENABLE_PER_CTX;
+        uint32_t ofs = (address - PLIC_REG_ENABLE0) % PLIC_ENABLE_PER_CTX;
+        if ((ctx / 2) >= m_harts.size() || ofs > (PLIC_REG_ENABLE3 - PLIC_REG_ENABLE0))
+            return false;
+
+        *hart = ctx / 2;
+        *idx  = ofs / 4;
+        return true;
+    }
+
+    // Threshold / claim register (reg) for context (M/S) of a hart
+    bool context_reg(uint32_t address, uint32_t reg, int *hart)
+    {
+        if (address < reg || ((address - reg) % PLIC_CONTEXT_PER_CTX) != 0)
+            return false;
+
+        uint32_t ctx = (address - reg) / PLIC_CONTEXT_PER_CTX;
+        if ((ctx / 2) >= m_harts.size())
+            return false;
+
+        *hart = ctx / 2;
+        return true;
+    }
+
+    struct plic_hart
+    {
+        cpu     *hart;
+        uint32_t enable[PLIC_IRQ_GROUPS];
+        uint8_t  prio_thresh;
+        bool     irq;
+    };
+
     uint8_t  m_prio[PLIC_NUM_IRQS];
     uint32_t m_pending[PLIC_IRQ_GROUPS];
-    uint32_t m_enable[PLIC_IRQ_GROUPS];
-    uint8_t  m_prio_thresh;
-    bool     m_irq;
+    std::vector<plic_hart> m_harts;
 };
 
 #endif
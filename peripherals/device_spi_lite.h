@@ -263,7 +263,8 @@ public:
             raise_interrupt();
         }
 
-        return 0;
+        // Shift clock only runs when enabled (register writes re-arm)
+        return (enable && !trans_inhibit) ? 0 : DEVICE_CLOCK_IDLE;
     }
 
 private:
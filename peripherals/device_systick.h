@@ -47,10 +47,13 @@ public:
         m_reg_csr     = 0;
         m_reg_reload  = 0;
         m_reg_current = 0;
+        m_sync        = clock_now();
     }
 
     bool write32(uint32_t address, uint32_t data)
     {
+        sync();
+
         address -= m_base;
         switch (address)
         {
@@ -71,6 +74,8 @@ public:
         data = 0;
         address -= m_base;        
 
+        sync();
+
         switch (address)
         {
             case TIMER_CSR:
@@ -91,36 +96,63 @@ public:
 
     int clock(void)
     {
+        sync();
+
+        // Interrupts enabled
+        if (m_irq && (m_reg_csr & (1 << TIMER_CSR_INTERRUPT_SHIFT)))
+        {
+            raise_interrupt();
+            m_irq = false;
+        }
+
+        // Next expiry (register writes re-arm)
+        bool enable = (m_reg_csr & (1 << TIMER_CSR_ENABLE_SHIFT)) != 0;
+        bool int_en = (m_reg_csr & (1 << TIMER_CSR_INTERRUPT_SHIFT)) != 0;
+        if (!enable || !int_en || m_reg_current >= DEVICE_CLOCK_IDLE)
+            return DEVICE_CLOCK_IDLE;
+
+        return (int)m_reg_current + 1;
+    }
+
+private:
+    //-----------------------------------------------------------------
+    // sync: Apply the steps elapsed since the last update
+    //-----------------------------------------------------------------
+    void sync(void)
+    {
+        uint64_t now   = clock_now();
+        uint64_t steps = now - m_sync;
+        m_sync = now;
+
+        if (steps == 0)
+            return ;
+
         // Timer disabled
         if (!(m_reg_csr & (1 << TIMER_CSR_ENABLE_SHIFT)))
         {
             m_reg_current = m_reg_reload;
             m_irq         = false;
         }
-        // Timer expired
-        else if (m_reg_current == 0)
-        {
-            m_reg_current = m_reg_reload;
-            m_irq         = true;
-        }
+        // Count down
+        else if (steps <= m_reg_current)
+            m_reg_current -= steps;
+        // Timer expired (reload, then continue counting down)
         else
-            m_reg_current-= 1;
-
-        // Interrupts enabled
-        if (m_irq && (m_reg_csr & (1 << TIMER_CSR_INTERRUPT_SHIFT)))
         {
-            raise_interrupt();
-            m_irq = false;
+            uint64_t period = (uint64_t)m_reg_reload + 1;
+            uint64_t left   = (steps - m_reg_current - 1) % period;
+
+            m_reg_current = m_reg_reload - left;
+            m_irq         = true;
         }
-        return 0;
     }
 
-private:
     uint32_t m_base_addr;
     bool     m_irq;
     uint32_t m_reg_csr;
     uint32_t m_reg_reload;
     uint32_t m_reg_current;
+    uint64_t m_sync;          // Step m_reg_current is valid at
 };
 
 #endif
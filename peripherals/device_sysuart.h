@@ -40,7 +40,7 @@ public:
 
     int clock(void)
     {
-        return 0;
+        return DEVICE_CLOCK_IDLE;
     }
 };
 
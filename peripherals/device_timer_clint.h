@@ -8,6 +8,7 @@
 #ifndef __DEVICE_TIMER_CLINT_H__
 #define __DEVICE_TIMER_CLINT_H__
 
+#include <vector>
 #include "device.h"
 #include "cpu.h"
 
@@ -21,6 +22,11 @@
 #define CLINT_REG_TIMER_VAL_HI  0xbffc
 #define CLINT_REG_SIZE          0xc000
 
+#define CLINT_MSIP_PER_HART     4
+#define CLINT_CMP_PER_HART      8
+#define CLINT_MAX_HARTS         4095
+
+#define IRQ_M_SOFT              3
 #define IRQ_M_TIMER             7
 
 //-----------------------------------------------------------------
@@ -32,39 +38,67 @@ public:
     device_timer_clint(uint32_t base_addr, cpu *cpu): device("clint", base_addr, CLINT_REG_SIZE, NULL, 0)
     {
         m_cpu = cpu;
+        attach_hart(0, cpu);
         reset();
     }
-    
+
+    // Additional harts (hart 0 is the CPU clocking this device)
+    void attach_hart(int hartid, cpu *hart)
+    {
+        if (hartid >= CLINT_MAX_HARTS)
+            return ;
+        if (hartid >= (int)m_harts.size())
+            m_harts.resize(hartid + 1);
+
+        m_harts[hartid].hart     = hart;
+        m_harts[hartid].cmp      = (uint64_t)-1;
+        m_harts[hartid].msip     = 0;
+        m_harts[hartid].irq      = false;
+        m_harts[hartid].irq_sync = false;
+    }
+
     void reset(void)
     {
-        m_reg_cmp  = (uint64_t)-1;
-        m_reg_val  = 0;
+        for (size_t i=0;i<m_harts.size();i++)
+        {
+            m_harts[i].cmp      = (uint64_t)-1;
+            m_harts[i].msip     = 0;
+            m_harts[i].irq      = false;
+            m_harts[i].irq_sync = false;
+        }
+        m_epoch    = clock_now();
     }
 
     bool write32(uint32_t address, uint32_t data)
     {
         address -= m_base;
-        switch (address)
+
+        int hart;
+        if (msip_reg(address, &hart))
+        {
+            // Software interrupt (may be for a hart on another thread)
+            m_harts[hart].msip = data & 1;
+            if (m_harts[hart].hart)
+                m_harts[hart].hart->post_interrupt(IRQ_M_SOFT, data & 1);
+        }
+        else if (cmp_reg(address, &hart))
         {
-            case CLINT_REG_MSIP:
-                if (data != 0)
-                {
-                    fprintf(stderr, "CLINT: Error - trying to raise MSIP - not supported yet\n");
-                    return false;
-                }
-                break;
-            case CLINT_REG_TIMER_CMP_LO:
-                m_reg_cmp &= ~0xffffffffull;
-                m_reg_cmp |= data;
-            break;
-            case CLINT_REG_TIMER_CMP_HI:
-                m_reg_cmp &= ~0xffffffff00000000ull;
-                m_reg_cmp |= ((uint64_t)data) << 32;
-            break;
-            default:
-                fprintf(stderr, "CLINT: Bad write @ %08x\n", address);
-                return false;
-            break;
+            uint64_t &cmp = m_harts[hart].cmp;
+            if (address & 4)
+            {
+                cmp &= ~0xffffffff00000000ull;
+                cmp |= ((uint64_t)data) << 32;
+            }
+            else
+            {
+                cmp &= ~0xffffffffull;
+                cmp |= data;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "CLINT: Bad write @ %08x\n", address);
+            return false;
         }
         return true;
     }
@@ -73,45 +107,118 @@ public:
         data = 0;
         address -= m_base;
 
-        switch (address)
+        int hart;
+        if (msip_reg(address, &hart))
+            data = m_harts[hart].msip;
+        else if (cmp_reg(address, &hart))
+            data = m_harts[hart].cmp >> ((address & 4) ? 32 : 0);
+        else if (address == CLINT_REG_TIMER_VAL_LO)
+            data = timer_val() >> 0;
+        else if (address == CLINT_REG_TIMER_VAL_HI)
+            data = timer_val() >> 32;
+        else
         {
-            case CLINT_REG_TIMER_CMP_LO:
-                data = m_reg_cmp >> 0;
-            break;
-            case CLINT_REG_TIMER_CMP_HI:
-                data = m_reg_cmp >> 32;
-            break;
-            case CLINT_REG_TIMER_VAL_LO:
-                data = m_reg_val >> 0;
-            break;
-            case CLINT_REG_TIMER_VAL_HI:
-                data = m_reg_val >> 32;
-            break;
-            default:
-                fprintf(stderr, "CLINT: Bad read @ %08x\n", address);
-                return false;
-            break;
+            fprintf(stderr, "CLINT: Bad read @ %08x\n", address);
+            return false;
         }
         return true;
     }
 
+    bool write64(uint32_t address, uint64_t data)
+    {
+        // Native 64-bit compare update
+        int hart;
+        if (cmp_reg(address - m_base, &hart) && !(address & 4))
+        {
+            m_harts[hart].cmp = data;
+            return true;
+        }
+        return device::write64(address, data);
+    }
+    bool read64(uint32_t address, uint64_t &data)
+    {
+        int hart;
+        if (cmp_reg(address - m_base, &hart) && !(address & 4))
+        {
+            data = m_harts[hart].cmp;
+            return true;
+        }
+        else if ((address - m_base) == CLINT_REG_TIMER_VAL_LO)
+        {
+            data = timer_val();
+            return true;
+        }
+        return device::read64(address, data);
+    }
+
     int clock(void)
     {
-        m_reg_val += 1;
+        uint64_t val   = timer_val();
+        uint64_t delta = DEVICE_CLOCK_IDLE;
 
-        // Timer match - should set MIP_MTIP
-        if (m_reg_val >= m_reg_cmp)
-            m_cpu->set_interrupt(IRQ_M_TIMER);
-        else
-            m_cpu->clr_interrupt(IRQ_M_TIMER);
-        
-        return 0;
+        for (size_t i=0;i<m_harts.size();i++)
+        {
+            clint_hart &h = m_harts[i];
+            if (!h.hart)
+                continue;
+
+            bool irq = val >= h.cmp;
+
+            // Timer match - should set MIP_MTIP (only signalled on change)
+            if (irq != h.irq || !h.irq_sync)
+            {
+                // Harts on other threads pick this up on their next step
+                if (h.hart != m_cpu)
+                    h.hart->post_interrupt(IRQ_M_TIMER, irq);
+                else if (irq)
+                    m_cpu->set_interrupt(IRQ_M_TIMER);
+                else
+                    m_cpu->clr_interrupt(IRQ_M_TIMER);
+
+                h.irq      = irq;
+                h.irq_sync = true;
+            }
+
+            // Next edge is the earliest compare match (or a register write)
+            if (!irq && (h.cmp - val) < delta)
+                delta = h.cmp - val;
+        }
+
+        return (int)delta;
     }
 
 private:
+    // Timer counts once per step since reset
+    uint64_t timer_val(void) { return clock_now() - m_epoch; }
+
+    // Per-hart register decode (offset from base)
+    bool msip_reg(uint32_t offset, int *hart)
+    {
+        if (offset >= CLINT_REG_MSIP + (m_harts.size() * CLINT_MSIP_PER_HART))
+            return false;
+        *hart = (offset - CLINT_REG_MSIP) / CLINT_MSIP_PER_HART;
+        return true;
+    }
+    bool cmp_reg(uint32_t offset, int *hart)
+    {
+        if (offset < CLINT_REG_TIMER_CMP_LO || offset >= CLINT_REG_TIMER_CMP_LO + (m_harts.size() * CLINT_CMP_PER_HART))
+            return false;
+        *hart = (offset - CLINT_REG_TIMER_CMP_LO) / CLINT_CMP_PER_HART;
+        return true;
+    }
+
+    struct clint_hart
+    {
+        cpu     *hart;
+        uint64_t cmp;
+        uint32_t msip;
+        bool     irq;
+        bool     irq_sync;
+    };
+
     cpu     *m_cpu;
-    uint64_t m_reg_cmp;
-    uint64_t m_reg_val;
+    std::vector<clint_hart> m_harts;
+    uint64_t m_epoch;
 };
 
 #endif
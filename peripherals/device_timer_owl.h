@@ -49,6 +49,7 @@ public:
             m_reg_ctrl[i] = 0;
             m_reg_cmp[i]  = 0;
             m_reg_val[i]  = 0;
+            m_epoch[i]    = 0;
         }
     }
 
@@ -59,22 +60,22 @@ public:
         switch (address)
         {
             case 0x08 + TIMER_CTRL:
-                m_reg_ctrl[0] = data;
+                write_ctrl(0, data);
             break;
             case 0x08 + TIMER_CMP:
                 m_reg_cmp[0] = data;
             break;
             case 0x08 + TIMER_VAL:
-                m_reg_val[0] = data;
+                write_val(0, data);
             break;
             case 0x14 + TIMER_CTRL:
-                m_reg_ctrl[1] = data;
+                write_ctrl(1, data);
             break;
             case 0x14 + TIMER_CMP:
                 m_reg_cmp[1] = data;
             break;
             case 0x14 + TIMER_VAL:
-                m_reg_val[1] = data;
+                write_val(1, data);
             break;
             default:
                 fprintf(stderr, "TimerOwl: Bad write @ %08x\n", address);
@@ -99,7 +100,7 @@ public:
                 data = m_reg_cmp[0];
             break;
             case 0x08 + TIMER_VAL:
-                data = m_reg_val[0];
+                data = timer_val(0);
             break;
             case 0x14 + TIMER_CTRL:
                 data = m_reg_ctrl[1];
@@ -108,7 +109,7 @@ public:
                 data = m_reg_cmp[1];
             break;
             case 0x14 + TIMER_VAL:
-                data = m_reg_val[1];
+                data = timer_val(1);
             break;
             default:
                 fprintf(stderr, "TimerOwl: Bad read @ %08x\n", address);
@@ -121,33 +122,61 @@ public:
 
     int clock(void)
     {
-        bool irq[NUM_TIMERS] = {false, false};
+        bool     irq  = false;
+        uint32_t next = DEVICE_CLOCK_IDLE;
 
         for (int i=0;i<NUM_TIMERS;i++)
         {
             uint32_t enable  = (m_reg_ctrl[i] & (1 << TIMER_CTRL_EN_SHIFT))    != 0;
             uint32_t int_en  = (m_reg_ctrl[i] & (1 << TIMER_CTRL_INTEN_SHIFT)) != 0;
 
-            // Timer disabled
-            if (enable)
-                m_reg_val[i] += 1;
+            // Timer disabled (or no interrupt)
+            if (!enable || !int_en)
+                continue;
 
             // Timer expired
-            if (m_reg_val[i] == m_reg_cmp[i])
-                irq[i] = enable && int_en;
+            uint32_t delta = m_reg_cmp[i] - timer_val(i);
+            if (delta == 0)
+                irq = true;
+            else if (delta < next)
+                next = delta;
         }
 
         // Interrupt generated
-        if (irq[1] || irq[0])
+        if (irq)
             raise_interrupt();
 
-        return 0;
+        return (int)next;
     }
 
 private:
+    bool enabled(int idx) { return (m_reg_ctrl[idx] & (1 << TIMER_CTRL_EN_SHIFT)) != 0; }
+
+    // Enabled timers count once per step from m_epoch
+    uint32_t timer_val(int idx)
+    {
+        if (enabled(idx))
+            return (uint32_t)(clock_now() - m_epoch[idx]);
+        return m_reg_val[idx];
+    }
+
+    void write_val(int idx, uint32_t data)
+    {
+        m_reg_val[idx] = data;
+        m_epoch[idx]   = clock_now() - data;
+    }
+
+    void write_ctrl(int idx, uint32_t data)
+    {
+        // Freeze / restart count
+        write_val(idx, timer_val(idx));
+        m_reg_ctrl[idx] = data;
+    }
+
     uint32_t m_reg_ctrl[NUM_TIMERS];
     uint32_t m_reg_cmp[NUM_TIMERS];
-    uint32_t m_reg_val[NUM_TIMERS];
+    uint32_t m_reg_val[NUM_TIMERS];   // Value when disabled
+    uint64_t m_epoch[NUM_TIMERS];     // Start of count when enabled
 };
 
 #endif
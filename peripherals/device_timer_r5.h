@@ -41,7 +41,7 @@ public:
     {
         m_reg_ctrl = 0;
         m_reg_cmp  = 0;
-        m_reg_val  = 0;
+        m_epoch    = clock_now();
     }
 
     bool write32(uint32_t address, uint32_t data)
@@ -76,7 +76,7 @@ public:
                 data = m_reg_cmp;
             break;
             case TIMER_VAL:
-                data = m_reg_val;
+                data = timer_val();
             break;
             default:
                 fprintf(stderr, "TimerOpenR5: Bad read @ %08x\n", address);
@@ -88,19 +88,29 @@ public:
 
     int clock(void)
     {
-        m_reg_val += 1;
+        // Interrupts disabled - idle until the control register is written
+        if (!(m_reg_ctrl & (1 << TIMER_CTRL_INTERRUPT_SHIFT)))
+            return DEVICE_CLOCK_IDLE;
 
-        // Interrupts enabled and timer match
-        if (m_reg_val == m_reg_cmp && (m_reg_ctrl & (1 << TIMER_CTRL_INTERRUPT_SHIFT)))
+        // Timer match
+        uint32_t delta = m_reg_cmp - timer_val();
+        if (delta == 0)
             raise_interrupt();
-        
-        return 0;
+
+        // Next match
+        if (delta == 0 || delta > DEVICE_CLOCK_IDLE)
+            return DEVICE_CLOCK_IDLE;
+
+        return (int)delta;
     }
 
 private:
+    // Timer counts once per step since reset
+    uint32_t timer_val(void) { return (uint32_t)(clock_now() - m_epoch); }
+
     uint32_t m_reg_ctrl;
     uint32_t m_reg_cmp;
-    uint32_t m_reg_val;
+    uint64_t m_epoch;
 };
 
 #endif
@@ -14,6 +14,8 @@
 //-----------------------------------------------------------------
 // Defines
 //-----------------------------------------------------------------
+#define UART8250_POLL_INTERVAL  1024 // Steps between console polls
+
 #define UART8250_RBR_OFFSET     0   // READ:  Recieve Buffer Register
 #define UART8250_THR_OFFSET     0   // WRITE: Transmitter Holding Register
 #define UART8250_IER_OFFSET     1   // READ/WRITE: Interrupt Enable Register
@@ -63,7 +65,7 @@ public:
         memset(m_reg, 0, UART8250_REG_SIZE);
         m_reg[UART8250_LSR_OFFSET] = UART8250_LSR_TEMT | UART8250_LSR_THRE;
         m_rx  = -1;
-        m_poll_count = 0;
+        m_poll_next = clock_now() + UART8250_POLL_INTERVAL;
     }
 
     bool write8(uint32_t address, uint8_t data)
@@ -121,25 +123,25 @@ public:
 
     int clock(void)
     {
+        uint64_t now = clock_now();
+
         // No rx char in the buffer, poll again...
-        if (m_rx == -1)
+        if (m_rx == -1 && now >= m_poll_next)
         {
-            if (m_poll_count++ == 1024)
-            {
-                m_poll_count = 0;
-                m_rx = m_console->getchar();
-                m_reg[UART8250_RBR_OFFSET] = (uint8_t)m_rx;
-            }
+            m_poll_next = now + UART8250_POLL_INTERVAL;
+            m_rx = m_console->getchar();
+            m_reg[UART8250_RBR_OFFSET] = (uint8_t)m_rx;
         }
 
-        return 0;
+        // Idle until next poll (or until the rx char is read)
+        return (m_rx == -1) ? (int)(m_poll_next - now) : DEVICE_CLOCK_IDLE;
     }
 
 private:
     console_io *m_console;
     uint8_t  m_reg[UART8250_REG_SIZE];
     int      m_rx;
-    int      m_poll_count;
+    uint64_t m_poll_next;
 };
 
 #endif
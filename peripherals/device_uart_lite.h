@@ -14,6 +14,8 @@
 //-----------------------------------------------------------------
 // Defines
 //-----------------------------------------------------------------
+#define ULITE_POLL_INTERVAL 1024  // Steps between console polls
+
 #define ULITE_RX          0x0
     #define ULITE_RX_DATA_SHIFT                  0
     #define ULITE_RX_DATA_MASK                   0xff
@@ -76,6 +78,7 @@ public:
         m_irq = false;
         m_rx  = -1;
         m_ctrl = 0;
+        m_poll_next = clock_now() + ULITE_POLL_INTERVAL;
     }
 
     bool write32(uint32_t address, uint32_t data)
@@ -138,18 +141,15 @@ public:
 
     int clock(void)
     {
+        uint64_t now = clock_now();
+
         // No rx char in the buffer, poll again...
-        if (m_rx == -1)
+        if (m_rx == -1 && now >= m_poll_next)
         {
-            static int poll_count = 0;
-
-            if (poll_count++ == 1024)
-            {
-                poll_count = 0;
-                m_rx = m_console->getchar();
-                if (m_rx != -1)
-                    m_irq = true;
-            }
+            m_poll_next = now + ULITE_POLL_INTERVAL;
+            m_rx = m_console->getchar();
+            if (m_rx != -1)
+                m_irq = true;
         }
 
         // Interrupts enabled
@@ -159,7 +159,8 @@ public:
             m_irq = false;
         }
 
-        return 0;
+        // Idle until next poll (or until accessed)
+        return (m_rx == -1) ? (int)(m_poll_next - now) : DEVICE_CLOCK_IDLE;
     }
 
 private:
@@ -167,6 +168,7 @@ private:
     console_io *m_console;
     uint32_t m_ctrl;
     int      m_rx;
+    uint64_t m_poll_next;
 };
 
 #endif
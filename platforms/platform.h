@@ -14,6 +14,9 @@ class platform
 {
 public:
     virtual cpu* get_cpu(void) = 0;
+
+    // Additional hart sharing memory / devices with get_cpu() (or NULL)
+    virtual cpu* create_hart(int hartid) { return NULL; }
 };
 
 #endif
\ No newline at end of file
@@ -17,6 +17,8 @@
 #include "device_systick.h"
 #include "device_sysuart.h"
 #include "device_dummy.h"
+#include "device_timer_clint.h"
+#include "device_irq_plic.h"
 
 class platform_cpu: public platform
 {
@@ -25,36 +27,11 @@ public:
     {
         m_cpu = NULL;
 
-        if (!strncmp(misa, "RV32", 4) || !strncmp(misa, "rv32", 4))
-        {
-            printf("Platform: Select %s\n", misa);
-            rv32 * cpu = new rv32(membase, memsize);
+        m_misa      = misa;
+        m_support_s = support_s;
 
-            // Simplified CSR handling for now...
-            cpu->enable_compliant_csr(support_s);
-
-            // Optional instruction sets
-            cpu->enable_rvm((strchr(misa, 'M') || strchr(misa, 'm')));
-            cpu->enable_rvc((strchr(misa, 'C') || strchr(misa, 'c')));
-            cpu->enable_rva((strchr(misa, 'A') || strchr(misa, 'a')));
-
-            m_cpu = cpu;
-        }
-        else if (!strncmp(misa, "RV64", 4) || !strncmp(misa, "rv64", 4))
-        {
+        if ((m_cpu = create_riscv(membase, memsize)) != NULL)
             printf("Platform: Select %s\n", misa);
-            rv64 *cpu = new rv64(membase, memsize);
-
-            // Simplified CSR handling for now...
-            cpu->enable_compliant_csr(support_s);
-
-            // Optional instruction sets
-            cpu->enable_rvm((strchr(misa, 'M') || strchr(misa, 'm')));
-            cpu->enable_rvc((strchr(misa, 'C') || strchr(misa, 'c')));
-            cpu->enable_rva((strchr(misa, 'A') || strchr(misa, 'a')));
-
-            m_cpu = cpu;
-        }
         else if (!strncmp(misa, "armv6", 5))
         {
             if (membase == 0)
@@ -80,7 +57,73 @@ public:
     }
 
     virtual cpu* get_cpu(void) { return m_cpu; }
-    cpu * m_cpu;
+
+    // RISC-V only: harts share the memories and devices of get_cpu()
+    virtual cpu* create_hart(int hartid)
+    {
+        cpu *owner = get_cpu();
+        if (!owner)
+            return NULL;
+
+        cpu *hart = create_riscv(0, 0);
+        if (!hart)
+            return NULL;
+
+        hart->set_hartid(hartid);
+        hart->share_memory(owner);
+
+        device_timer_clint *clint = (device_timer_clint *)owner->find_device("clint", 0);
+        if (clint)
+            clint->attach_hart(hartid, hart);
+
+        device_irq_plic *plic = (device_irq_plic *)owner->find_device("plic", 0);
+        if (plic)
+            plic->attach_hart(hartid, hart);
+
+        return hart;
+    }
+
+protected:
+    cpu* create_riscv(uint32_t membase, uint32_t memsize)
+    {
+        const char *misa = m_misa.c_str();
+
+        if (!strncmp(misa, "RV32", 4) || !strncmp(misa, "rv32", 4))
+        {
+            rv32 * cpu = new rv32(membase, memsize);
+
+            // Simplified CSR handling for now...
+            cpu->enable_compliant_csr(m_support_s);
+
+            // Optional instruction sets
+            cpu->enable_rvm((strchr(misa, 'M') || strchr(misa, 'm')));
+            cpu->enable_rvc((strchr(misa, 'C') || strchr(misa, 'c')));
+            cpu->enable_rva((strchr(misa, 'A') || strchr(misa, 'a')));
+
+            return cpu;
+        }
+        else if (!strncmp(misa, "RV64", 4) || !strncmp(misa, "rv64", 4))
+        {
+            rv64 *cpu = new rv64(membase, memsize);
+
+            // Simplified CSR handling for now...
+            cpu->enable_compliant_csr(m_support_s);
+
+            // Optional instruction sets
+            cpu->enable_rvm((strchr(misa, 'M') || strchr(misa, 'm')));
+            cpu->enable_rvc((strchr(misa, 'C') || strchr(misa, 'c')));
+            cpu->enable_rva((strchr(misa, 'A') || strchr(misa, 'a')));
+
+            return cpu;
+        }
+
+        return NULL;
+    }
+
+public:
+    cpu *       m_cpu;
+    std::string m_misa;
+    bool        m_support_s;
 };
 
 #endif
\ No newline at end of file
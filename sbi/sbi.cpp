@@ -9,6 +9,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <thread>
 
 #include "sbi.h"
 #include "rv32.h"
@@ -28,6 +29,10 @@
 #define SBI_REMOTE_SFENCE_VMA_ASID 7
 #define SBI_SHUTDOWN               8
 #define SBI_EXT_BASE               16
+#define SBI_EXT_TIME               0x54494D45
+#define SBI_EXT_IPI                0x735049
+#define SBI_EXT_RFENCE             0x52464E43
+#define SBI_EXT_HSM                0x48534D
 
 #define SBI_EXT_SPEC_VERSION       0
 #define SBI_EXT_IMPL_ID            1
@@ -37,33 +42,59 @@
 #define SBI_EXT_GET_MARCHID        5
 #define SBI_EXT_GET_MIMPID         6
 
+#define SBI_EXT_RFENCE_FENCE_I     0
+#define SBI_EXT_RFENCE_SFENCE_VMA  1
+#define SBI_EXT_RFENCE_SFENCE_ASID 2
+
+#define SBI_EXT_HSM_HART_START     0
+#define SBI_EXT_HSM_HART_STOP      1
+#define SBI_EXT_HSM_HART_STATUS    2
+
+// v0.2 return codes (a0, a1 = value)
+#define SBI_SUCCESS                0
+#define SBI_ERR_FAILED             -1
+#define SBI_ERR_NOT_SUPPORTED      -2
+#define SBI_ERR_INVALID_PARAM      -3
+#define SBI_ERR_ALREADY_AVAILABLE  -6
+
+#define IRQ_S_SOFT                 1
+
 //-----------------------------------------------------------------
 // setup: Setup SBI handler (and load some binaries)
 //-----------------------------------------------------------------
-bool sbi::setup(cpu *cpu, console_io *conio, uint32_t kernel_addr, uint32_t dtb_addr)
+bool sbi::setup(cpu *cpu, console_io *conio, uint32_t kernel_addr, uint32_t dtb_addr, smp *harts /*= NULL*/)
 {
-    if (cpu->get_reg_width() == 64)
-    {
-        ((rv64*)cpu)->sbi_boot(kernel_addr, dtb_addr);
-        ((rv64*)cpu)->enable_mem_unaligned(true);
-    }
-    else
+    sbi *handler = new sbi(conio, harts);
+    int  count   = harts ? harts->get_num_harts() : 1;
+
+    for (int i=0;i<count;i++)
     {
-        ((rv32*)cpu)->sbi_boot(kernel_addr, dtb_addr);
-        ((rv32*)cpu)->enable_mem_unaligned(true);
-    }
+        class cpu *hart = harts ? harts->get_hart(i) : cpu;
 
-    // Register SBI syscall handler
-    cpu->set_syscall_handler(new sbi(conio));
+        if (hart->get_reg_width() == 64)
+        {
+            ((rv64*)hart)->sbi_boot(kernel_addr, dtb_addr);
+            ((rv64*)hart)->enable_mem_unaligned(true);
+        }
+        else
+        {
+            ((rv32*)hart)->sbi_boot(kernel_addr, dtb_addr);
+            ((rv32*)hart)->enable_mem_unaligned(true);
+        }
+
+        // Register SBI syscall handler
+        hart->set_syscall_handler(handler);
+    }
 
     return true;
 }
 //-----------------------------------------------------------------
 // Construction
 //-----------------------------------------------------------------
-sbi::sbi(console_io *conio)
+sbi::sbi(console_io *conio, smp *harts /*= NULL*/)
 {
     m_conio = conio;
+    m_harts = harts;
 }
 //-----------------------------------------------------------------
 // sbi_ext: Extended SBI API
@@ -73,14 +104,24 @@ uint32_t sbi::sbi_ext(uint32_t fid, uint32_t extid)
     switch (fid)
     {
         case SBI_EXT_SPEC_VERSION:
-            return 0x1;
+            return 0x2;
         case SBI_EXT_PROBE_EXTENSION:
             switch (extid)
             {
                 case SBI_CONSOLE_PUTCHAR:
                 case SBI_CONSOLE_GETCHAR:
                 case SBI_SET_TIMER:
+                case SBI_CLEAR_IPI:
+                case SBI_SEND_IPI:
+                case SBI_REMOTE_FENCE_I:
+                case SBI_REMOTE_SFENCE_VMA:
+                case SBI_REMOTE_SFENCE_VMA_ASID:
+                case SBI_SHUTDOWN:
                 case SBI_EXT_BASE:
+                case SBI_EXT_TIME:
+                case SBI_EXT_IPI:
+                case SBI_EXT_RFENCE:
+                case SBI_EXT_HSM:
                     return 1;
                 default:
                     return 0;
@@ -93,6 +134,121 @@ uint32_t sbi::sbi_ext(uint32_t fid, uint32_t extid)
     return 0;
 }
 //-----------------------------------------------------------------
+// hart_selected: Hart in (hart_mask, hart_mask_base) - base ~0 = all
+//-----------------------------------------------------------------
+bool sbi::hart_selected(int hart, uint64_t mask, uint64_t base)
+{
+    if (base == ~(uint64_t)0)
+        return true;
+
+    return (uint64_t)hart >= base && ((uint64_t)hart - base) < 64 &&
+           ((mask >> ((uint64_t)hart - base)) & 1);
+}
+//-----------------------------------------------------------------
+// legacy_mask: Read the hart mask a legacy (v0.1) call points to
+// (NULL = all harts, unreadable = none)
+//-----------------------------------------------------------------
+void sbi::legacy_mask(cpu *caller, uint64_t addr, uint64_t *mask, uint64_t *base)
+{
+    *mask = 0;
+    *base = 0;
+
+    if (!addr)
+        *base = ~(uint64_t)0;
+    else if (caller->get_reg_width() == 64)
+    {
+        if (!((rv64*)caller)->read_data(addr, mask, 8))
+            *mask = 0;
+    }
+    else
+    {
+        uint32_t val;
+        if (((rv32*)caller)->read_data(addr, &val, 4))
+            *mask = val;
+    }
+}
+//-----------------------------------------------------------------
+// send_ipi: Raise supervisor software interrupt on selected harts
+//-----------------------------------------------------------------
+void sbi::send_ipi(cpu *caller, uint64_t mask, uint64_t base)
+{
+    if (!m_harts)
+    {
+        if (hart_selected(0, mask, base))
+            caller->post_interrupt(IRQ_S_SOFT, true);
+        return ;
+    }
+
+    for (int i=0;i<m_harts->get_num_harts();i++)
+        if (hart_selected(i, mask, base) && m_harts->hart_status(i) == HART_STARTED)
+            m_harts->get_hart(i)->post_interrupt(IRQ_S_SOFT, true);
+}
+//-----------------------------------------------------------------
+// remote_fence: Apply fences on selected harts (and wait for them)
+//-----------------------------------------------------------------
+void sbi::remote_fence(cpu *caller, uint64_t mask, uint64_t base, uint32_t fences)
+{
+    int count = m_harts ? m_harts->get_num_harts() : 1;
+
+    for (int i=0;i<count;i++)
+    {
+        cpu *hart = m_harts ? m_harts->get_hart(i) : caller;
+        if (!hart_selected(i, mask, base))
+            continue;
+        if (hart != caller && m_harts->hart_status(i) != HART_STARTED)
+            continue;
+
+        hart->post_fence(fences);
+    }
+
+    // Local fence now, remote harts apply theirs on their next step.
+    // Requests to this hart are serviced while waiting (no deadlock).
+    // Interleaved harts are not running, so no wait is needed.
+    caller->poll_posted();
+    for (int i=0;i<count && m_harts && !m_harts->get_quantum();i++)
+    {
+        cpu *hart = m_harts->get_hart(i);
+        while (hart != caller && hart->fence_pending(fences))
+        {
+            hart_state state = m_harts->hart_status(i);
+            if (state != HART_STARTED && state != HART_STOP_PENDING)
+                break;
+
+            caller->poll_posted();
+            std::this_thread::yield();
+        }
+    }
+}
+//-----------------------------------------------------------------
+// hsm: Hart state management extension
+//-----------------------------------------------------------------
+int64_t sbi::hsm(cpu *caller, uint32_t fid, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t *value)
+{
+    int harts = m_harts ? m_harts->get_num_harts() : 1;
+
+    switch (fid)
+    {
+        case SBI_EXT_HSM_HART_START:
+            if (a0 >= (uint64_t)harts)
+                return SBI_ERR_INVALID_PARAM;
+            if (!m_harts || !m_harts->hart_start(a0, a1, a2, caller))
+                return SBI_ERR_ALREADY_AVAILABLE;
+            return SBI_SUCCESS;
+        case SBI_EXT_HSM_HART_STOP:
+            // Hart 0 clocks the devices
+            if (!m_harts || caller->get_hartid() == 0 || !m_harts->hart_stop(caller->get_hartid()))
+                return SBI_ERR_FAILED;
+            return SBI_SUCCESS;
+        case SBI_EXT_HSM_HART_STATUS:
+            if (a0 >= (uint64_t)harts)
+                return SBI_ERR_INVALID_PARAM;
+            *value = m_harts ? m_harts->hart_status(a0) : HART_STARTED;
+            return SBI_SUCCESS;
+        default:
+            return SBI_ERR_NOT_SUPPORTED;
+    }
+}
+//-----------------------------------------------------------------
 // syscall_handler: Try and execute a hosted system call
 //-----------------------------------------------------------------
 bool sbi::syscall_handler(cpu *cpu)
@@ -103,10 +259,30 @@ bool sbi::syscall_handler(cpu *cpu)
     uint64_t a0    = (cpu->get_reg_width() == 64) ? cpu->get_register64(reg_a0 + 0) : cpu->get_register(reg_a0 + 0);
     uint64_t a1    = (cpu->get_reg_width() == 64) ? cpu->get_register64(reg_a0 + 1) : cpu->get_register(reg_a0 + 1);
     uint64_t a2    = (cpu->get_reg_width() == 64) ? cpu->get_register64(reg_a0 + 2) : cpu->get_register(reg_a0 + 2);
+    uint64_t fid   = (cpu->get_reg_width() == 64) ? cpu->get_register64(reg_a0 + 6) : cpu->get_register(reg_a0 + 6);
     uint64_t which = (cpu->get_reg_width() == 64) ? cpu->get_register64(reg_a0 + 7) : cpu->get_register(reg_a0 + 7);
 
+    // Hart mask base (a1) of all ones selects all harts
+    uint64_t base  = (cpu->get_reg_width() == 32 && a1 == 0xFFFFFFFF) ? ~(uint64_t)0 : a1;
+    uint64_t mask  = 0;
+
     #define SET_RET(x) cpu->set_register(reg_ret, (uint32_t)(x))
 
+    // v0.2 extensions: a0 = error, a1 = value
+    #define SET_RET2(err, val) \
+        do { \
+            if (cpu->get_reg_width() == 64) \
+            { \
+                cpu->set_register(reg_ret + 0, (uint64_t)(int64_t)(err)); \
+                cpu->set_register(reg_ret + 1, (uint64_t)(val)); \
+            } \
+            else \
+            { \
+                cpu->set_register(reg_ret + 0, (uint32_t)(err)); \
+                cpu->set_register(reg_ret + 1, (uint32_t)(val)); \
+            } \
+        } while (0)
+
     // Only take over syscalls in SUPER mode
     if (cpu->get_reg_width() == 64)
     {
@@ -127,11 +303,15 @@ bool sbi::syscall_handler(cpu *cpu)
             return true;
         case SBI_CONSOLE_PUTCHAR:
             if (m_conio)
+            {
+                std::lock_guard<std::mutex> lock(m_console_lock);
                 m_conio->putchar(a0);
+            }
             return true;
         case SBI_CONSOLE_GETCHAR:
             if (m_conio)
             {
+                std::lock_guard<std::mutex> lock(m_console_lock);
                 if (cpu->get_reg_width() == 64)
                     ((rv64*)cpu)->set_register(reg_ret, (uint64_t)m_conio->getchar());
                 else
@@ -144,12 +324,66 @@ bool sbi::syscall_handler(cpu *cpu)
             else
                 ((rv32*)cpu)->set_timer(a0);
             return true;
+        case SBI_CLEAR_IPI:
+            cpu->clr_interrupt(IRQ_S_SOFT);
+            return true;
+        // Legacy calls pass a pointer to the hart mask
+        case SBI_SEND_IPI:
+            legacy_mask(cpu, a0, &mask, &base);
+            send_ipi(cpu, mask, base);
+            return true;
         case SBI_REMOTE_FENCE_I:
+            legacy_mask(cpu, a0, &mask, &base);
+            remote_fence(cpu, mask, base, CPU_FENCE_I);
+            return true;
         case SBI_REMOTE_SFENCE_VMA:
+        case SBI_REMOTE_SFENCE_VMA_ASID:
+            legacy_mask(cpu, a0, &mask, &base);
+            remote_fence(cpu, mask, base, CPU_FENCE_VMA);
             return true;
         case SBI_EXT_BASE:
-            SET_RET(sbi_ext(a0, a1));
+            SET_RET2(SBI_SUCCESS, sbi_ext(fid, a0));
+            return true;
+        case SBI_EXT_TIME:
+            if (fid != 0)
+                SET_RET2(SBI_ERR_NOT_SUPPORTED, 0);
+            else
+            {
+                if (cpu->get_reg_width() == 64)
+                    ((rv64*)cpu)->set_timer(a0);
+                else
+                    ((rv32*)cpu)->set_timer(a0);
+                SET_RET2(SBI_SUCCESS, 0);
+            }
+            return true;
+        case SBI_EXT_IPI:
+            if (fid != 0)
+                SET_RET2(SBI_ERR_NOT_SUPPORTED, 0);
+            else
+            {
+                send_ipi(cpu, a0, base);
+                SET_RET2(SBI_SUCCESS, 0);
+            }
+            return true;
+        case SBI_EXT_RFENCE:
+            if (fid == SBI_EXT_RFENCE_FENCE_I)
+                remote_fence(cpu, a0, base, CPU_FENCE_I);
+            else if (fid == SBI_EXT_RFENCE_SFENCE_VMA || fid == SBI_EXT_RFENCE_SFENCE_ASID)
+                remote_fence(cpu, a0, base, CPU_FENCE_VMA);
+            else
+            {
+                SET_RET2(SBI_ERR_NOT_SUPPORTED, 0);
+                return true;
+            }
+            SET_RET2(SBI_SUCCESS, 0);
+            return true;
+        case SBI_EXT_HSM:
+        {
+            uint64_t value = 0;
+            int64_t  err   = hsm(cpu, fid, a0, a1, a2, &value);
+            SET_RET2(err, value);
             return true;
+        }
         default:
             printf("SBI: Unhandled SYSCALL, stopping... (id=%d)\n", which);
             exit(-1);
@@ -11,7 +11,9 @@
 #include <string>
 #include <stdint.h>
 #include <vector>
+#include <mutex>
 #include "cpu.h"
+#include "smp.h"
 #include "syscall_if.h"
 
 //-----------------------------------------------------------------
@@ -20,14 +22,23 @@
 class sbi: public syscall_if
 {
 public:
-    sbi(console_io *conio);
+    sbi(console_io *conio, smp *harts = NULL);
     bool syscall_handler(cpu *instance);
     uint32_t sbi_ext(uint32_t fid, uint32_t extid);
 
-    static bool setup(cpu *cpu, console_io *conio, uint32_t kernel_addr, uint32_t dtb_addr);
+    // Secondary harts (if harts) are stopped until started via HSM
+    static bool setup(cpu *cpu, console_io *conio, uint32_t kernel_addr, uint32_t dtb_addr, smp *harts = NULL);
 
 protected:
+    bool        hart_selected(int hart, uint64_t mask, uint64_t base);
+    void        legacy_mask(cpu *caller, uint64_t addr, uint64_t *mask, uint64_t *base);
+    void        send_ipi(cpu *caller, uint64_t mask, uint64_t base);
+    void        remote_fence(cpu *caller, uint64_t mask, uint64_t base, uint32_t fences);
+    int64_t     hsm(cpu *caller, uint32_t fid, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t *value);
+
     console_io *m_conio;
+    smp        *m_harts;
+    std::mutex  m_console_lock;
 };
 
 #endif
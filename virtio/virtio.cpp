@@ -272,8 +272,7 @@ t_virtio_desc virtio::get_desc(int q, int idx)
     uint64_t addr = m_queue[q].desc_addr + (idx * sizeof(t_virtio_desc));
 
     uint8_t buf[16];
-    for (int i=0;i<sizeof(buf);i++)
-        buf[i] = m_mem->read(addr + i);
+    m_mem->read_block(addr, buf, sizeof(buf));
 
     t_virtio_desc *d_ptr = (t_virtio_desc *)buf;
     return *d_ptr;
@@ -358,15 +357,9 @@ bool virtio::queue_access(uint8_t *buf, int queue_idx, int desc_idx, int offset,
             l = (desc.len - offset);
 
         if (to_queue)
-        {
-            for (int i=0;i<l;i++)
-                m_mem->write(desc.addr + offset + i, buf[i]);
-        }
+            m_mem->write_block(desc.addr + offset, buf, l);
         else
-        {
-            for (int i=0;i<l;i++)
-                buf[i] = m_mem->read(desc.addr + offset + i);
-        }
+            m_mem->read_block(desc.addr + offset, buf, l);
         count -= l;
         if (count == 0)
             break;